@@ -0,0 +1,265 @@
+/*
+ * Aggregate transition state
+ *
+ * Python functions that take and return "internal" can be used as the
+ * transition and final functions of aggregates. The state is a Python object
+ * referenced by a small structure allocated in the aggregate's memory context,
+ * so it is not converted to, or rebuilt from, a Datum on every row.
+ *
+ * The references to the state objects are held by a dictionary keyed by the
+ * structure's address. Before 9.6, the states are released after the final
+ * function of a sorted or plain aggregate is called; later versions may call
+ * the final functions of several aggregates on one shared state. On 9.5 and
+ * later, a reset callback of the memory context holding the structure
+ * releases the states, so the states of hashed and window aggregates do not
+ * outlive their memory. Before 9.5,
+ * memory contexts are reset without notice, so those states are released
+ * when a new state is allocated at the same address and, at the latest, at
+ * the end of the transaction.
+ *
+ * The same protocol supports the combine, serialization, and deserialization
+ * functions of parallel aggregation on 9.6 and later: a combine function
+ * takes and returns internal, and the deserialization function returns a new
+ * state.
+ */
+#include <setjmp.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "nodes/execnodes.h"
+#include "nodes/plannodes.h"
+#include "utils/memutils.h"
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/extension.h"
+#include "pypg/error.h"
+#include "pypg/aggregate.h"
+
+/*
+ * Identifies the states created here; the state of an aggregate may have
+ * been created by a transition function written in C.
+ */
+#define AGG_STATE_MAGIC 0x50795374
+
+struct agg_state {
+	uint32 as_magic;
+	PyObj as_state;			/* borrowed; agg_states holds the reference */
+	unsigned long as_xid;	/* ext_xact_count of the allocation */
+#if PG_VERSION_NUM >= 90500
+	MemoryContextCallback as_reset;	/* releases as_state */
+#endif
+};
+
+#define IsAggState(S) ((S) != NULL && (S)->as_magic == AGG_STATE_MAGIC)
+
+/*
+ * {address of struct agg_state : state object}
+ */
+static PyObj agg_states = NULL;
+
+#if PG_VERSION_NUM >= 90500
+static void
+agg_reset_callback(void *arg)
+{
+	if (Py_IsInitialized())
+		agg_release_state(PointerGetDatum(arg));
+}
+#endif
+
+/*
+ * Initialize the structure held by the memory context.
+ */
+static void
+agg_init(struct agg_state *s, MemoryContext context)
+{
+	s->as_magic = AGG_STATE_MAGIC;
+	s->as_state = NULL;
+	s->as_xid = ext_xact_count;
+
+#if PG_VERSION_NUM >= 90500
+	s->as_reset.func = agg_reset_callback;
+	s->as_reset.arg = (void *) s;
+	MemoryContextRegisterResetCallback(context, &(s->as_reset));
+#endif
+}
+
+int
+agg_call_context(FunctionCallInfo fcinfo, MemoryContext *aggcontext)
+{
+#if PG_VERSION_NUM >= 90000
+	return(AggCheckCallContext(fcinfo, aggcontext));
+#else
+	if (fcinfo->context == NULL)
+		return(0);
+
+	if (IsA(fcinfo->context, AggState))
+	{
+		*aggcontext = ((AggState *) fcinfo->context)->aggcontext;
+		return(AGG_CONTEXT_AGGREGATE);
+	}
+
+	if (IsA(fcinfo->context, WindowAggState))
+	{
+		*aggcontext = ((WindowAggState *) fcinfo->context)->wincontext;
+		return(AGG_CONTEXT_WINDOW);
+	}
+
+	return(0);
+#endif
+}
+
+PyObj
+agg_get_state(Datum d)
+{
+	struct agg_state *s = (struct agg_state *) DatumGetPointer(d);
+
+	/*
+	 * Deserialization functions are given a NULL pointer as their internal
+	 * argument.
+	 */
+	if (s == NULL)
+		return(Py_None);
+
+	if (!IsAggState(s))
+	{
+		PyErr_SetString(PyExc_TypeError,
+			"aggregate state was not created by a Python function");
+		return(NULL);
+	}
+
+	if (s->as_state == NULL || s->as_xid != ext_xact_count)
+		return(Py_None);
+
+	return(s->as_state);
+}
+
+Datum
+agg_set_state(MemoryContext aggcontext, Datum previous, bool previous_isnull, PyObj state)
+{
+	struct agg_state * volatile s = NULL;
+	PyObj key;
+	int r;
+
+	if (agg_states == NULL)
+	{
+		agg_states = PyDict_New();
+		if (agg_states == NULL)
+			return(0);
+	}
+
+	if (!previous_isnull)
+		s = (struct agg_state *) DatumGetPointer(previous);
+
+	/*
+	 * Transition functions usually update the state in place and return it.
+	 */
+	if (IsAggState(s) && s->as_xid == ext_xact_count && s->as_state == state)
+		return(previous);
+
+	if (!IsAggState(s) || s->as_xid != ext_xact_count)
+	{
+		s = NULL;
+		PG_TRY();
+		{
+			s = MemoryContextAlloc(aggcontext, sizeof(struct agg_state));
+			agg_init(s, aggcontext);
+		}
+		PG_CATCH();
+		{
+			s = NULL;
+			PyErr_SetPgError(false);
+		}
+		PG_END_TRY();
+
+		if (s == NULL)
+			return(0);
+	}
+
+	key = PyLong_FromVoidPtr((void *) s);
+	if (key == NULL)
+		return(0);
+	r = PyDict_SetItem(agg_states, key, state);
+	Py_DECREF(key);
+	if (r == -1)
+		return(0);
+
+	s->as_state = state;
+	return(PointerGetDatum(s));
+}
+
+Size
+agg_state_size(void)
+{
+	return(sizeof(struct agg_state));
+}
+
+Datum
+agg_init_state(void *mem)
+{
+	struct agg_state *s = (struct agg_state *) mem;
+
+	if (!IsAggState(s) || s->as_xid != ext_xact_count)
+	{
+#if PG_VERSION_NUM >= 90500
+		agg_init(s, GetMemoryChunkContext(mem));
+#else
+		agg_init(s, NULL);
+#endif
+	}
+
+	return(PointerGetDatum(s));
+}
+
+void
+agg_release_state(Datum d)
+{
+	struct agg_state *s = (struct agg_state *) DatumGetPointer(d);
+	PyObj key;
+
+	if (!IsAggState(s) || s->as_state == NULL || agg_states == NULL)
+		return;
+	s->as_state = NULL;
+
+	key = PyLong_FromVoidPtr((void *) s);
+	if (key == NULL || PyDict_DelItem(agg_states, key) == -1)
+		PyErr_Clear();
+	Py_XDECREF(key);
+}
+
+bool
+agg_state_is_final(FunctionCallInfo fcinfo, int aggkind)
+{
+#if PG_VERSION_NUM >= 90600
+	/*
+	 * Aggregates with the same transition function and arguments share a
+	 * state, and each of their final functions is given it. The reset
+	 * callback releases it once the aggregates are done.
+	 */
+	return(false);
+#else
+	AggState *aggstate;
+
+	/*
+	 * Window aggregates call the final function for every row of the frame.
+	 */
+	if (aggkind != AGG_CONTEXT_AGGREGATE || !IsA(fcinfo->context, AggState))
+		return(false);
+
+	/*
+	 * Hash tables may be rescanned without rebuilding the states.
+	 */
+	aggstate = (AggState *) fcinfo->context;
+	return(((Agg *) aggstate->ss.ps.plan)->aggstrategy != AGG_HASHED);
+#endif
+}
+
+void
+agg_release_all(void)
+{
+	if (agg_states != NULL)
+		PyDict_Clear(agg_states);
+}
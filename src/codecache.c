@@ -0,0 +1,318 @@
+/*
+ * Persistent cache of compiled function modules
+ *
+ * Compiling a function's source is done on first call in every backend. When
+ * python.code_cache_directory is set, the compiled code is marshalled into the
+ * directory so that subsequent backends can skip the compilation.
+ *
+ * Entries are keyed by the database, the function's Oid, the xmin of the
+ * pg_proc row, a hash of the source and the filename(co_filename), the Python
+ * bytecode magic number, and the optimization level. Any change to the function
+ * results in a new key; stale entries are never read again, but they are not
+ * removed either. Clearing the directory is always safe.
+ */
+#include <setjmp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <compile.h>
+#include <marshal.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "access/hash.h"
+#include "utils/guc.h"
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/pl.h"
+#include "pypg/stats.h"
+#include "pypg/function.h"
+#include "pypg/codecache.h"
+
+char *pl_code_cache_directory = NULL;
+
+/*
+ * Only warn once per backend about a cache directory that cannot be written.
+ */
+static bool store_warned = false;
+
+/*
+ * Only warn once per backend about a cache directory that cannot be trusted.
+ */
+static bool directory_warned = false;
+
+void
+code_cache_init(void)
+{
+	static bool defined = false;
+
+	if (defined)
+		return;
+
+#if PG_VERSION_NUM >= 90100
+	DefineCustomStringVariable("python.code_cache_directory",
+		"Directory used to cache compiled function modules.",
+		"The directory must be owned by the server's user and must not be "
+		"writable by anyone else. An empty string disables the cache.",
+		&pl_code_cache_directory, "",
+		PGC_SIGHUP, 0, NULL, NULL, NULL);
+#else
+	DefineCustomStringVariable("python.code_cache_directory",
+		"Directory used to cache compiled function modules.",
+		"The directory must be owned by the server's user and must not be "
+		"writable by anyone else. An empty string disables the cache.",
+		&pl_code_cache_directory, "",
+		PGC_SIGHUP, 0, NULL, NULL);
+#endif
+
+	defined = true;
+}
+
+static uint32
+hash_string(PyObj str)
+{
+	PyObj b;
+	uint32 h;
+
+	b = PyUnicode_AsUTF8String(str);
+	if (b == NULL)
+		return(0);
+
+	h = DatumGetUInt32(hash_any((unsigned char *) PyBytes_AS_STRING(b),
+		PyBytes_GET_SIZE(b)));
+	Py_DECREF(b);
+
+	return(h);
+}
+
+/*
+ * code_cache_directory_unsafe - check the ownership and mode of the directory
+ *
+ * Cached code is executed when it is loaded, so a directory that can be
+ * written by other users would let them run code as the server. Returns true,
+ * after warning once, when the directory exists and must not be used.
+ */
+static bool
+code_cache_directory_unsafe(void)
+{
+#ifndef WIN32
+	struct stat st;
+	const char *detail = NULL;
+
+	/*
+	 * A missing directory is reported by code_cache_store.
+	 */
+	if (stat(pl_code_cache_directory, &st) != 0)
+		return(false);
+
+	if (!S_ISDIR(st.st_mode))
+		detail = "The path is not a directory.";
+	else if (st.st_uid != geteuid())
+		detail = "The directory is not owned by the server's user.";
+	else if (st.st_mode & (S_IWGRP | S_IWOTH))
+		detail = "The directory is writable by its group or by others.";
+
+	if (detail == NULL)
+		return(false);
+
+	if (!directory_warned)
+	{
+		directory_warned = true;
+		ereport(WARNING,(
+			errmsg("ignoring Python code cache directory \"%s\"",
+				pl_code_cache_directory),
+			errdetail("%s", detail),
+			errhint("Make the directory writable only by the server's user.")
+		));
+	}
+
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/*
+ * code_cache_path - build the path of the function's cache entry
+ *
+ * Returns false, possibly with a Python exception set, when the function
+ * cannot be cached.
+ */
+static bool
+code_cache_path(PyObj func, char *path)
+{
+	PyObj src, filename;
+	uint32 src_hash, filename_hash;
+
+	src = PyPgFunction_GetSource(func);
+	filename = PyPgFunction_GetFilename(func);
+	if (PyPgFunction_GetOid(func) == InvalidOid
+		|| src == NULL || !PyUnicode_Check(src) || filename == NULL)
+		return(false);
+
+	src_hash = hash_string(src);
+	if (PyErr_Occurred())
+		return(false);
+	filename_hash = hash_string(filename);
+	if (PyErr_Occurred())
+		return(false);
+
+	snprintf(path, MAXPGPATH, "%s/%u.%u.%u.%08x.%08x.%lx.%d",
+		pl_code_cache_directory,
+		MyDatabaseId,
+		PyPgFunction_GetOid(func),
+		PyPgFunction_GetXMin(func),
+		src_hash, filename_hash,
+		PyImport_GetMagicNumber(),
+		Py_OptimizeFlag);
+
+	return(true);
+}
+
+PyObj
+code_cache_load(PyObj func)
+{
+	char path[MAXPGPATH];
+	struct stat st;
+	FILE *f;
+	char *buf;
+	size_t size;
+	PyObj code;
+
+	if (pl_code_cache_directory == NULL || pl_code_cache_directory[0] == '\0')
+		return(NULL);
+
+	if (code_cache_directory_unsafe())
+		return(NULL);
+
+	if (!code_cache_path(func, path))
+	{
+		PyErr_Clear();
+		return(NULL);
+	}
+
+	if (stat(path, &st) != 0 || st.st_size <= 0)
+		goto miss;
+#ifndef WIN32
+	/*
+	 * Entries are written by the server; ignore anything else.
+	 */
+	if (st.st_uid != geteuid())
+		goto miss;
+#endif
+
+	f = fopen(path, PG_BINARY_R);
+	if (f == NULL)
+		goto miss;
+
+	size = (size_t) st.st_size;
+	buf = PyMem_Malloc(size);
+	if (buf == NULL)
+	{
+		fclose(f);
+		PyErr_Clear();
+		goto miss;
+	}
+
+	if (fread(buf, 1, size, f) != size)
+	{
+		PyMem_Free(buf);
+		fclose(f);
+		goto miss;
+	}
+	fclose(f);
+
+	code = PyMarshal_ReadObjectFromString(buf, (Py_ssize_t) size);
+	PyMem_Free(buf);
+
+	if (code == NULL)
+	{
+		/*
+		 * Truncated or corrupt entry; compile and overwrite it.
+		 */
+		PyErr_Clear();
+		goto miss;
+	}
+	if (!PyCode_Check(code))
+	{
+		Py_DECREF(code);
+		goto miss;
+	}
+
+	++(pl_stats.st_code_cache_hits);
+	return(code);
+miss:
+	++(pl_stats.st_code_cache_misses);
+	return(NULL);
+}
+
+void
+code_cache_store(PyObj func, PyObj code)
+{
+	char path[MAXPGPATH];
+	char tmppath[MAXPGPATH];
+	PyObj data;
+	FILE *f;
+	bool ok;
+	int save_errno = 0;
+
+	if (pl_code_cache_directory == NULL || pl_code_cache_directory[0] == '\0')
+		return;
+
+	if (code_cache_directory_unsafe())
+		return;
+
+	if (!code_cache_path(func, path))
+	{
+		PyErr_Clear();
+		return;
+	}
+
+	data = PyMarshal_WriteObjectToString(code, Py_MARSHAL_VERSION);
+	if (data == NULL)
+	{
+		PyErr_Clear();
+		return;
+	}
+
+	/*
+	 * Write to a backend specific file and rename it into place so that
+	 * concurrent readers never see a partial entry.
+	 */
+	snprintf(tmppath, MAXPGPATH, "%s.%d.tmp", path, MyProcPid);
+
+	f = fopen(tmppath, PG_BINARY_W);
+	if (f == NULL)
+		ok = false;
+	else
+	{
+		ok = fwrite(PyBytes_AS_STRING(data), 1, PyBytes_GET_SIZE(data), f)
+			== (size_t) PyBytes_GET_SIZE(data);
+		if (fclose(f) != 0)
+			ok = false;
+		if (ok && rename(tmppath, path) != 0)
+			ok = false;
+		if (!ok)
+		{
+			save_errno = errno;
+			unlink(tmppath);
+		}
+	}
+	if (!ok && save_errno == 0)
+		save_errno = errno;
+	Py_DECREF(data);
+
+	if (!ok && !store_warned)
+	{
+		store_warned = true;
+		errno = save_errno;
+		ereport(WARNING,(
+			errmsg("could not write Python code cache file \"%s\": %m", path),
+			errhint("Check the \"python.code_cache_directory\" setting.")
+		));
+	}
+}
@@ -252,6 +252,11 @@
 /* storage/large_object.h */
 	C(LOBLKSIZE)
 
+/* windowapi.h */
+	C(WINDOW_SEEK_CURRENT)
+	C(WINDOW_SEEK_HEAD)
+	C(WINDOW_SEEK_TAIL)
+
 /* End Of ints */
 #undef OBJECTIFY
 
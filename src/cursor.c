@@ -36,7 +36,9 @@
 #include "pypg/extension.h"
 #include "pypg/pl.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
 #include "pypg/function.h"
+#include "pypg/stats.h"
 
 #include "pypg/tupledesc.h"
 #include "pypg/type/type.h"
@@ -146,7 +148,7 @@ cursor_is_closed(PyObj self, const char *action)
 			PyPgCursor_SetPortal(self, NULL);
 			ereport(ERROR, (
 				errmsg("cannot use '%s' operation on a closed cursor", action),
-				errhint("All Postgres.Cursor objects are closed at the end of a transaction.")
+				errhint("Postgres.Cursor objects are closed at the end of a transaction unless created WITH HOLD.")
 			));
 		}
 	}
@@ -179,7 +181,12 @@ get_more(PyObj self, bool forward, long count)
 
 	PG_TRY();
 	{
+		instr_time spi_start;
+
+		PL_STATS_SPI_CALL();
+		PL_STATS_START(spi_start);
 		SPI_cursor_fetch(p, forward, count);
+		PL_STATS_SPI_ACCUM(spi_start);
 		if (SPI_result < 0)
 			raise_spi_error(SPI_result);
 		i = 1;
@@ -252,7 +259,12 @@ column_get_more(PyObj self, bool forward, long count)
 
 	PG_TRY();
 	{
+		instr_time spi_start;
+
+		PL_STATS_SPI_CALL();
+		PL_STATS_START(spi_start);
 		SPI_cursor_fetch(p, forward, count);
+		PL_STATS_SPI_ACCUM(spi_start);
 		if (SPI_result < 0)
 			raise_spi_error(SPI_result);
 		i = 1;
@@ -306,6 +318,141 @@ column_get_more(PyObj self, bool forward, long count)
 	return(rob);
 }
 
+/*
+ * Release the rows read ahead.
+ */
+static void
+clear_buffer(PyObj self)
+{
+	PyObj buf = PyPgCursor_GetBuffer(self);
+
+	PyPgCursor_SetBuffer(self, NULL);
+	PyPgCursor_SetAhead(self, 0);
+	PyPgCursor_SetAtEdge(self, false);
+	Py_XDECREF(buf);
+}
+
+/*
+ * Move the Portal of a declare() cursor back to the cursor's position and
+ * discard the rows that were read ahead.
+ *
+ * Operations other than __next__ work with the Portal's position, so this is
+ * called before seeking, reading, or changing the direction.
+ */
+static int
+sync_position(PyObj self, const char *action)
+{
+	PyObj buf = PyPgCursor_GetBuffer(self);
+	long count;
+
+	if (buf == NULL)
+		return(0);
+
+	count = PyPgCursor_GetAhead(self);
+	if (PyPgCursor_GetAtEdge(self))
+		++count;
+
+	clear_buffer(self);
+
+	if (count == 0)
+		return(0);
+
+	if (cursor_is_closed(self, action))
+		return(-1);
+
+	PG_TRY();
+	{
+		SPI_scroll_cursor_move(PyPgCursor_GetPortal(self),
+			PyPgCursor_GetDirection(self) ? FETCH_BACKWARD : FETCH_FORWARD, count);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+		return(-1);
+	}
+	PG_END_TRY();
+
+	return(0);
+}
+
+/*
+ * Get the next row of a declare() cursor.
+ *
+ * Rows are read CUR_READ_AHEAD at a time and returned from cur_buffer.
+ */
+static PyObj
+declared_next(PyObj self)
+{
+	PyObj buf = PyPgCursor_GetBuffer(self);
+	PyObj chunk, rob;
+
+	/*
+	 * The rows read ahead are not returned once the Portal is gone; get_more
+	 * reports the closed cursor otherwise.
+	 */
+	if (buf != NULL && PyPgCursor_IsClosed(self))
+	{
+		clear_buffer(self);
+		cursor_is_closed(self, "read");
+		return(NULL);
+	}
+
+	if (buf != NULL)
+	{
+		rob = PyIter_Next(buf);
+		if (rob != NULL)
+		{
+			PyPgCursor_SetAhead(self, PyPgCursor_GetAhead(self) - 1);
+			return(rob);
+		}
+		if (PyErr_Occurred())
+			return(NULL);
+
+		/*
+		 * Exhausted; the Portal is positioned at the last row returned,
+		 * or past the edge when the read reached it.
+		 */
+		PyPgCursor_SetBuffer(self, NULL);
+		Py_DECREF(buf);
+
+		if (PyPgCursor_GetAtEdge(self))
+		{
+			PyPgCursor_SetAtEdge(self, false);
+			return(NULL);
+		}
+	}
+
+	chunk = get_more(self, PyPgCursor_GetDirection(self), CUR_READ_AHEAD);
+	if (chunk == NULL)
+		return(NULL);
+
+	buf = PyObject_GetIter(chunk);
+	if (buf == NULL)
+	{
+		Py_DECREF(chunk);
+		return(NULL);
+	}
+
+	PyPgCursor_SetBuffer(self, buf);
+	PyPgCursor_SetAhead(self, PyList_GET_SIZE(chunk));
+	PyPgCursor_SetAtEdge(self, PyList_GET_SIZE(chunk) < CUR_READ_AHEAD);
+	Py_DECREF(chunk);
+
+	if (PyPgCursor_GetAhead(self) == 0)
+	{
+		/*
+		 * Already past the edge.
+		 */
+		PyPgCursor_SetBuffer(self, NULL);
+		PyPgCursor_SetAtEdge(self, false);
+		Py_DECREF(buf);
+		return(NULL);
+	}
+
+	PyPgCursor_SetAhead(self, PyPgCursor_GetAhead(self) - 1);
+	return(PyIter_Next(buf));
+}
+
 static PyObj
 cursor_get_column_names(PyObj self, void *unused)
 {
@@ -382,6 +529,10 @@ cursor_set_direction(PyObj self, PyObj val, void *unused)
 	if (truth == -1)
 		return(-1);
 
+	if (PyPgCursor_GetBuffer(self) != NULL
+		&& (DB_IS_NOT_READY() || sync_position(self, "direction")))
+		return(-1);
+
 	PyPgCursor_SetChunksize(self, truth ? 1 : -1);
 
 	return(0);
@@ -457,6 +608,8 @@ static PyMemberDef PyPgCursor_Members[] = {
 		PyDoc_STR("The Postgres.Statement object that created the cursor")},
 	{"parameters", T_OBJECT, offsetof(struct PyPgCursor, cur_parameters), READONLY,
 		PyDoc_STR("The original parameters given to statement")},
+	{"hold", T_BOOL, offsetof(struct PyPgCursor, cur_hold), READONLY,
+		PyDoc_STR("Whether the cursor remains open after the transaction commits")},
 	{NULL}
 };
 
@@ -486,7 +639,8 @@ cursor_clone(PyObj self)
 		PyPgCursor_GetStatement(self),
 		PyPgCursor_GetParameters(self),
 		NULL, /* keywords */
-		PyPgCursor_GetChunksize(self));
+		PyPgCursor_GetChunksize(self),
+		PyPgCursor_IsHeld(self));
 
 	return(rob);
 }
@@ -525,6 +679,32 @@ cursor_seek(PyObj self, PyObj args, PyObj kw)
 			return(NULL);
 	}
 
+	/*
+	 * Relative moves in the cursor's direction that stay within the rows
+	 * read ahead are made by skipping them.
+	 */
+	if (whence == whence__RELATIVE && count > 0
+		&& count <= PyPgCursor_GetAhead(self))
+	{
+		PyObj buf = PyPgCursor_GetBuffer(self);
+		long i;
+
+		for (i = 0; i < count; ++i)
+		{
+			PyObj row = PyIter_Next(buf);
+
+			if (row == NULL)
+				return(NULL);
+			Py_DECREF(row);
+		}
+		PyPgCursor_SetAhead(self, PyPgCursor_GetAhead(self) - count);
+
+		return(PyLong_FromLong(count));
+	}
+
+	if (sync_position(self, "seek"))
+		return(NULL);
+
 	p = PyPgCursor_GetPortal(self);
 
 	PG_TRY();
@@ -664,6 +844,9 @@ cursor_read(PyObj self, PyObj args, PyObj kw)
 	else
 		forward = false; /* -1 */
 
+	if (sync_position(self, "read"))
+		return(NULL);
+
 	if (count < 0)
 	{
 		Py_ssize_t last_count;
@@ -824,24 +1007,7 @@ cursor_next(PyObj self)
 	if (PyPgCursor_IsDeclared(self))
 	{
 		/* Scrollable Cursor */
-		bool forward = PyPgCursor_GetDirection(self);
-
-		rob = get_more(self, forward, 1);
-		if (rob == NULL)
-			return(NULL);
-		if (PyList_Size(rob) == 0)
-		{
-			Py_DECREF(rob);
-			rob = NULL;
-		}
-		else
-		{
-			PyObj row;
-			row = PyList_GET_ITEM(rob, 0);
-			Py_INCREF(row);
-			Py_DECREF(rob);
-			rob = row;
-		}
+		rob = declared_next(self);
 	}
 	else if (PyPgCursor_IsChunks(self))
 	{
@@ -961,7 +1127,8 @@ PyPgCursor_NEW(
 	PyTypeObject *subtype,
 	PyObj statement,
 	PyObj args, PyObj kw,
-	Py_ssize_t chunksize)
+	Py_ssize_t chunksize,
+	bool hold)
 {
 	PyObj tdo = PyPgStatement_GetInput(statement);
 	TupleDesc td = PyPgTupleDesc_GetTupleDesc(tdo);
@@ -979,6 +1146,14 @@ PyPgCursor_NEW(
 		PyErr_SetString(PyExc_ValueError, "invalid chunksize parameter");
 		return(NULL);
 	}
+	else if (hold)
+	{
+		/*
+		 * The Portal takes its options from the plan.
+		 */
+		plan = PyPgStatement_GetHoldPlan(statement,
+			chunksize == -1 || chunksize == 1);
+	}
 	else if (chunksize == -1 || chunksize == 1)
 	{
 		plan = PyPgStatement_GetScrollPlan(statement);
@@ -1018,6 +1193,7 @@ PyPgCursor_NEW(
 	PyPgCursor_SetOutput(rob, output);
 
 	PyPgCursor_SetChunksize(rob, chunksize);
+	PyPgCursor_SetHeld(rob, hold);
 	PyPgCursor_SetXid(rob, ext_xact_count);
 
 	PG_TRY();
@@ -1027,6 +1203,7 @@ PyPgCursor_NEW(
 		bool *nulls;
 		char *cnulls;
 		int i;
+		instr_time spi_start;
 
 		datums = palloc(sizeof(Datum) * td->natts);
 		nulls = palloc(sizeof(bool) * td->natts);
@@ -1042,7 +1219,10 @@ PyPgCursor_NEW(
 			cnulls[i] = nulls[i] ? 'n' : ' ';
 		}
 
+		PL_STATS_SPI_CALL();
+		PL_STATS_START(spi_start);
 		p = SPI_cursor_open(NULL, plan, datums, cnulls, PL_FN_READONLY());
+		PL_STATS_SPI_ACCUM(spi_start);
 		PyPgCursor_SetPortal(rob, p);
 		PyPgCursor_SetName(rob, MemoryContextStrdup(PythonMemoryContext, p->name));
 		PyPgCursor_SetXid(rob, ext_xact_count);
@@ -1076,6 +1256,8 @@ PyPgCursor_Close(PyObj self)
 	 * whereas cursor_is_closed goes further to validate
 	 * that the Portal is still active using SPI_cursor_find.
 	 */
+	clear_buffer(self);
+
 	if (PyPgCursor_IsClosed(self))
 		PyPgCursor_SetPortal(self, NULL);
 	else
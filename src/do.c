@@ -144,6 +144,7 @@ initialize_inline_executor(Oid langOid)
 	pl_inline_executor_info.fi_module = module;
 	pl_inline_executor_info.fi_state = NULL;
 	pl_inline_executor_info.fi_output = output;
+	pl_inline_executor_info.fi_stats = NULL;
 
 	pl_inline_executor_fmgrinfo.fn_extra = &pl_inline_executor_info;
 	pl_inline_executor_fmgrinfo.fn_oid = InvalidOid;
@@ -170,11 +171,17 @@ pl_inline(PG_FUNCTION_ARGS)
 
 	Assert(IsA(codeblock, InlineCodeBlock));
 
+	if (ext_state == init_pending)
+		ext_entry();
+
+	/*
+	 * Reset the environment if the role has changed before the inline
+	 * executor is initialized or used.
+	 */
+	ext_isolate();
+
 	if (pl_inline_executor_fcinfo.flinfo == NULL)
 	{
-		if (ext_state == init_pending)
-			ext_entry();
-
 		/*
 		 * Initialize the pseudo-function for executing DO-blocks.
 		 */
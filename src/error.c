@@ -17,6 +17,8 @@
 #include "utils/elog.h"
 #include "utils/builtins.h"
 #include "utils/memutils.h"
+#include "utils/guc.h"
+#include "lib/stringinfo.h"
 #include "mb/pg_wchar.h"
 #include "catalog/pg_type.h"
 
@@ -26,6 +28,7 @@
 #include "pypg/pl.h"
 #include "pypg/errcodes.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
 #include "pypg/errordata.h"
 #include "pypg/function.h"
 
@@ -36,6 +39,45 @@ PyObj PyExc_PostgresException = NULL;
 
 static PyObj FormatTraceback = NULL;
 
+/*
+ * Deferred tracebacks
+ *
+ * Formatting a traceback is expensive, and the ERRORs thrown by Python
+ * functions are frequently caught by a subtransaction and discarded. On 9.2
+ * and later, the errcontext of a thrown exception only contains a marker
+ * referring to the exception, and emit_log_hook replaces the marker with the
+ * formatted traceback when the error is actually reported.
+ *
+ * Only the most recent DEFERRED_TRACEBACKS exceptions are kept, and they are
+ * discarded at the end of the transaction.
+ */
+#define DEFERRED_TRACEBACK_MARKER "<deferred Python traceback "
+#define DEFERRED_TRACEBACKS 32
+
+static PyObj deferred_tracebacks = NULL;	/* id -> (exc, val, tb) */
+static unsigned long deferred_traceback_id = 0;
+
+#if PG_VERSION_NUM >= 90200
+static emit_log_hook_type previous_emit_log_hook = NULL;
+static bool emit_log_hook_installed = false;
+
+static void
+emit_deferred_tracebacks(ErrorData *edata)
+{
+	if (edata->context != NULL && Py_IsInitialized() && ext_state != ext_term)
+	{
+		char *ctx;
+
+		ctx = expand_deferred_tracebacks(edata->context);
+		if (ctx != NULL)
+			edata->context = ctx;
+	}
+
+	if (previous_emit_log_hook)
+		previous_emit_log_hook(edata);
+}
+#endif
+
 void
 error_init_tracebacks(void)
 {
@@ -62,6 +104,25 @@ error_init_tracebacks(void)
 			errcode(ERRCODE_PYTHON_ERROR),
 			errmsg("failed to get 'format_exception' from Python traceback module")
 		));
+
+	if (deferred_tracebacks == NULL)
+	{
+		deferred_tracebacks = PyDict_New();
+		if (deferred_tracebacks == NULL)
+			ereport(ERROR,(
+				errcode(ERRCODE_PYTHON_ERROR),
+				errmsg("failed to create deferred traceback dictionary")
+			));
+	}
+
+#if PG_VERSION_NUM >= 90200
+	if (!emit_log_hook_installed)
+	{
+		previous_emit_log_hook = emit_log_hook;
+		emit_log_hook = emit_deferred_tracebacks;
+		emit_log_hook_installed = true;
+	}
+#endif
 }
 
 /*
@@ -102,18 +163,20 @@ sqlerrcode_from_PyObject(PyObj errcode_ob, int *errcode_out)
 	return(true);
 }
 
+static char *context(bool incontext, bool display_full_exc);
+
 /*
  * Build out the entire Python traceback and exception information.
+ *
+ * Steals the references to the given exception.
  */
 static char *
-context(bool incontext, bool display_full_exc)
+format_exception(PyObj exc, PyObj val, PyObj tb, bool incontext, bool display_full_exc)
 {
-	PyObj exc, val, tb, rob;
+	PyObj rob;
 	Py_ssize_t errlen;
 	char *r;
 
-	PyErr_Fetch(&exc, &val, &tb);
-	PyErr_NormalizeException(&exc, &val, &tb);
 	if (tb == NULL)
 	{
 		tb = Py_None;
@@ -205,6 +268,187 @@ context(bool incontext, bool display_full_exc)
 	return(r);
 }
 
+/*
+ * Format the current Python exception.
+ */
+static char *
+context(bool incontext, bool display_full_exc)
+{
+	PyObj exc, val, tb;
+
+	PyErr_Fetch(&exc, &val, &tb);
+	PyErr_NormalizeException(&exc, &val, &tb);
+
+	return(format_exception(exc, val, tb, incontext, display_full_exc));
+}
+
+/*
+ * Whether the marker of the ERROR being thrown is certain to be expanded.
+ *
+ * Other code that catches the error, such as a PL/pgSQL EXCEPTION block,
+ * copies the context without passing through emit_log_hook. Such handlers
+ * run the code they protect in a subtransaction, so the traceback is only
+ * deferred when every open subtransaction is an IST of the PL: the error is
+ * then either caught by a Python function, whose ErrorData expands the
+ * context, or reported. When log_min_messages excludes ERRORs, the hook is
+ * not called when the error is reported.
+ */
+static bool
+can_defer_traceback(void)
+{
+#if PG_VERSION_NUM >= 90200
+	return(emit_log_hook_installed && deferred_tracebacks != NULL
+		&& log_min_messages != LOG && log_min_messages <= ERROR
+		&& GetCurrentTransactionNestLevel() == 1 + (int) ist_count);
+#else
+	return(false);
+#endif
+}
+
+/*
+ * deferred_context - context() for ERRORs
+ *
+ * Keeps the current Python exception and returns a marker to be replaced
+ * by expand_deferred_tracebacks(). Falls back to context() when the
+ * traceback cannot be deferred.
+ */
+static char *
+deferred_context(void)
+{
+	PyObj exc, val, tb, key, entry;
+	unsigned long id;
+	char *r;
+
+	if (!can_defer_traceback())
+		return(context(false, false));
+
+	PyErr_Fetch(&exc, &val, &tb);
+	PyErr_NormalizeException(&exc, &val, &tb);
+	if (exc == NULL)
+		return(format_exception(exc, val, tb, false, false));
+
+	id = ++deferred_traceback_id;
+	entry = Py_BuildValue("(OOO)", exc,
+		val != NULL ? val : Py_None, tb != NULL ? tb : Py_None);
+	key = PyLong_FromUnsignedLong(id);
+	if (entry == NULL || key == NULL
+		|| PyDict_SetItem(deferred_tracebacks, key, entry))
+	{
+		Py_XDECREF(entry);
+		Py_XDECREF(key);
+		PyErr_Clear();
+		return(format_exception(exc, val, tb, false, false));
+	}
+	Py_DECREF(entry);
+	Py_DECREF(key);
+	Py_DECREF(exc);
+	Py_XDECREF(val);
+	Py_XDECREF(tb);
+
+	if (id > DEFERRED_TRACEBACKS)
+	{
+		key = PyLong_FromUnsignedLong(id - DEFERRED_TRACEBACKS);
+		if (key == NULL || PyDict_DelItem(deferred_tracebacks, key))
+			PyErr_Clear();
+		Py_XDECREF(key);
+	}
+
+	r = palloc(sizeof(DEFERRED_TRACEBACK_MARKER) + 24);
+	sprintf(r, DEFERRED_TRACEBACK_MARKER "%lu>", id);
+
+	return(r);
+}
+
+/*
+ * discard_deferred_tracebacks - forget the exceptions kept by deferred_context()
+ *
+ * Called at the end of the transaction; the errors have been reported or
+ * discarded by then.
+ */
+void
+discard_deferred_tracebacks(void)
+{
+	if (deferred_tracebacks != NULL && PyDict_Size(deferred_tracebacks) > 0)
+		PyDict_Clear(deferred_tracebacks);
+}
+
+/*
+ * expand_deferred_tracebacks - replace the markers made by deferred_context()
+ *
+ * Returns a new string, or NULL if the context has no markers.
+ */
+char *
+expand_deferred_tracebacks(const char *ctx)
+{
+	PyObj exc, val, tb;
+	StringInfoData buf;
+	const char *p, *m;
+
+	if (ctx == NULL || deferred_tracebacks == NULL
+		|| (m = strstr(ctx, DEFERRED_TRACEBACK_MARKER)) == NULL)
+		return(NULL);
+
+	/*
+	 * Preserve any exception that may be set.
+	 */
+	PyErr_Fetch(&exc, &val, &tb);
+
+	initStringInfo(&buf);
+	p = ctx;
+	do
+	{
+		PyObj key, entry = NULL;
+		unsigned long id;
+		char *end;
+
+		appendBinaryStringInfo(&buf, p, m - p);
+		m += sizeof(DEFERRED_TRACEBACK_MARKER) - 1;
+
+		id = strtoul(m, &end, 10);
+		if (end == m || *end != '>')
+		{
+			appendStringInfoString(&buf, DEFERRED_TRACEBACK_MARKER);
+			p = m;
+			continue;
+		}
+		p = end + 1;
+
+		key = PyLong_FromUnsignedLong(id);
+		if (key != NULL)
+		{
+			entry = PyDict_GetItem(deferred_tracebacks, key);
+			Py_DECREF(key);
+		}
+
+		if (entry == NULL)
+		{
+			PyErr_Clear();
+			appendStringInfoString(&buf, "<Python traceback no longer available>");
+		}
+		else
+		{
+			char *data;
+
+			Py_INCREF(PyTuple_GET_ITEM(entry, 0));
+			Py_INCREF(PyTuple_GET_ITEM(entry, 1));
+			Py_INCREF(PyTuple_GET_ITEM(entry, 2));
+			data = format_exception(
+				PyTuple_GET_ITEM(entry, 0),
+				PyTuple_GET_ITEM(entry, 1),
+				PyTuple_GET_ITEM(entry, 2),
+				false, false);
+			appendStringInfoString(&buf, data);
+			pfree(data);
+		}
+	}
+	while ((m = strstr(p, DEFERRED_TRACEBACK_MARKER)) != NULL);
+	appendStringInfoString(&buf, p);
+
+	PyErr_Restore(exc, val, tb);
+
+	return(buf.data);
+}
+
 static void
 emit_exception_errcontext(const char *context_data, const char *desc, PyObj fn_filename)
 {
@@ -289,6 +533,25 @@ ecc_context(void *arg)
 	pfree(data);
 }
 
+/*
+ * ecc_deferred_context - ecc_context() for thrown ERRORs
+ */
+static void
+ecc_deferred_context(void *arg)
+{
+	struct pl_exec_state *pl_ctx = arg;
+	PyObj filename;
+	const char *desc;
+	char *data;
+
+	collect_errcontext_params(pl_ctx, &desc, &filename);
+
+	data = deferred_context();
+
+	emit_exception_errcontext(data, desc, filename);
+	pfree(data);
+}
+
 void
 PyErr_RelayException(void)
 {
@@ -382,12 +645,30 @@ PyErr_ThrowPostgresErrorWithContext(int code, const char *errstr, struct pl_exec
 
 		PG_TRY();
 		{
+			ErrorData *edata = PyPgErrorData_GetErrorData(errdata_ob);
+
 			if (!inhibit_pl_context)
-				errcontext_data = context(false, false);
+				errcontext_data = deferred_context();
 			else
 				PyErr_Clear();
 
-			ReThrowError(PyPgErrorData_GetErrorData(errdata_ob));
+			/*
+			 * The caught error's context may hold the markers of the
+			 * functions that threw it. Expand them when this error's
+			 * context could be read by something other than the PL.
+			 */
+			if (edata->context != NULL && !can_defer_traceback())
+			{
+				char *ctx = expand_deferred_tracebacks(edata->context);
+
+				if (ctx != NULL)
+				{
+					edata->context = MemoryContextStrdup(PythonMemoryContext, ctx);
+					pfree(ctx);
+				}
+			}
+
+			ReThrowError(edata);
 		}
 		PG_CATCH();
 		{
@@ -435,7 +716,7 @@ PyErr_ThrowPostgresErrorWithContext(int code, const char *errstr, struct pl_exec
 		}
 		else
 		{
-			ecc.callback = ecc_context;
+			ecc.callback = ecc_deferred_context;
 			ecc.previous = error_context_stack;
 			ecc.arg = (void *) pl_ctx;
 			error_context_stack = &ecc;
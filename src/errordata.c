@@ -136,8 +136,37 @@ static PyObj
 errdata_get_context(PyObj self, void *arg)
 {
 	ErrorData *ed = PyPgErrorData_GetErrorData(self);
+
 	if (ed->context)
+	{
+		volatile bool failed = false;
+
+		/*
+		 * Format any deferred tracebacks now, and keep the result so that it
+		 * is not formatted again when the error is re-thrown.
+		 */
+		PG_TRY();
+		{
+			char *ctx = expand_deferred_tracebacks(ed->context);
+
+			if (ctx != NULL)
+			{
+				ed->context = MemoryContextStrdup(PythonMemoryContext, ctx);
+				pfree(ctx);
+			}
+		}
+		PG_CATCH();
+		{
+			PyErr_SetPgError(false);
+			failed = true;
+		}
+		PG_END_TRY();
+
+		if (failed)
+			return(NULL);
+
 		return(PyUnicode_FromCString(ed->context));
+	}
 	Py_INCREF(Py_None);
 	return(Py_None);
 }
@@ -25,6 +25,9 @@
 #include "access/htup.h"
 #include "access/heapam.h"
 #include "access/xact.h"
+#if PG_VERSION_NUM >= 90600
+#include "access/parallel.h"
+#endif
 #include "access/transam.h"
 #include "access/tupdesc.h"
 #include "catalog/namespace.h"
@@ -45,6 +48,7 @@
 #include "utils/array.h"
 #include "utils/datum.h"
 #include "utils/elog.h"
+#include "utils/guc.h"
 #include "utils/builtins.h"
 #include "utils/hsearch.h"
 #include "utils/syscache.h"
@@ -63,6 +67,12 @@
 #include "pypg/errcodes.h"
 #include "pypg/error.h"
 #include "pypg/ist.h"
+#include "pypg/stats.h"
+#include "pypg/codecache.h"
+#include "pypg/shared.h"
+#include "pypg/notify.h"
+#include "pypg/worker.h"
+#include "pypg/aggregate.h"
 #include "pypg/type/type.h"
 #include "pypg/type/object.h"
 #include "pypg/type/record.h"
@@ -108,6 +118,161 @@ MemoryContext PythonMemoryContext = NULL, PythonWorkMemoryContext = NULL;
 PyObj TransactionScope = NULL;
 PyObj Py_Postgres_module = NULL;
 
+int ext_isolation = ext_isolation_none;
+char *ext_preload = NULL;
+
+static const struct config_enum_entry isolation_options[] = {
+	{"none", ext_isolation_none, false},
+	{"role", ext_isolation_role, false},
+	{NULL, 0, false}
+};
+
+/*
+ * The role that the environment was last used by, and the transaction
+ * that it was checked in.
+ */
+static Oid isolation_role = InvalidOid;
+static unsigned long isolation_xact = 0;
+
+/*
+ * Whether python.preload has been processed by this backend. Cleared when
+ * the environment is reset.
+ */
+static bool preloaded = false;
+
+static void
+settings_init(void)
+{
+	static bool defined = false;
+
+	if (defined)
+		return;
+
+#if PG_VERSION_NUM >= 90100
+	DefineCustomEnumVariable("python.isolation",
+		"Reset the Python environment when the role changes.",
+		"When set to \"role\", function modules and the modules they "
+		"imported are dropped before a transaction that runs as a "
+		"different role than the previous one.",
+		&ext_isolation, ext_isolation_none, isolation_options,
+		PGC_SUSET, 0, NULL, NULL, NULL);
+#else
+	DefineCustomEnumVariable("python.isolation",
+		"Reset the Python environment when the role changes.",
+		"When set to \"role\", function modules and the modules they "
+		"imported are dropped before a transaction that runs as a "
+		"different role than the previous one.",
+		&ext_isolation, ext_isolation_none, isolation_options,
+		PGC_SUSET, 0, NULL, NULL);
+#endif
+
+#if PG_VERSION_NUM >= 90100
+	DefineCustomStringVariable("python.preload",
+		"Schemas and functions to load on first use.",
+		"A comma separated list of schema names and function signatures. "
+		"The listed functions are loaded by the first call of a Python "
+		"function in each backend.",
+		&ext_preload, "",
+		PGC_SUSET, 0, NULL, NULL, NULL);
+#else
+	DefineCustomStringVariable("python.preload",
+		"Schemas and functions to load on first use.",
+		"A comma separated list of schema names and function signatures. "
+		"The listed functions are loaded by the first call of a Python "
+		"function in each backend.",
+		&ext_preload, "",
+		PGC_SUSET, 0, NULL, NULL);
+#endif
+
+	defined = true;
+}
+
+/*
+ * ext_isolate - reset the environment if the role has changed
+ *
+ * Only the first entry of a transaction is checked; nested calls and
+ * the remainder of the transaction continue to use the same modules.
+ * The role is the one set by SET ROLE, or the session user, so calling a
+ * SECURITY DEFINER function does not cause a reset.
+ */
+void
+ext_isolate(void)
+{
+	Oid role;
+	PyObj ob;
+
+	if (ext_isolation == ext_isolation_none || isolation_xact == ext_xact_count)
+		return;
+	isolation_xact = ext_xact_count;
+
+	role = GetCurrentRoleId();
+	if (!OidIsValid(role))
+		role = GetSessionUserId();
+
+	if (role == isolation_role)
+		return;
+
+	/*
+	 * Nothing has been loaded before ext_entry(), so just note the role.
+	 */
+	if (OidIsValid(isolation_role) && ext_state != init_pending)
+	{
+		ob = PyObject_CallMethod(Py_Postgres_module, "reset", "");
+		if (ob == NULL)
+			PyErr_ThrowPostgresError("could not reset the Python environment");
+		Py_DECREF(ob);
+
+		++(pl_stats.st_resets);
+		preloaded = false;
+		ereport(DEBUG1,(
+			errmsg("reset the Python environment for role %u", role)));
+	}
+	isolation_role = role;
+}
+
+/*
+ * ext_preload_functions - load the functions listed by python.preload
+ *
+ * Called by the first function call in the backend, once SPI is connected.
+ * The module of each function is loaded, which also builds its
+ * Postgres.Function object and caches its parameter and result types.
+ * Failures to load individual entries are reported as WARNINGs by
+ * Postgres._preload_setting.
+ */
+void
+ext_preload_functions(Oid fn_oid)
+{
+	PyObj ob;
+
+	if (preloaded)
+		return;
+	/* Set first; the loaded modules may call other Python functions. */
+	preloaded = true;
+
+	if (ext_preload == NULL || ext_preload[0] == '\0')
+		return;
+
+#if PG_VERSION_NUM >= 90500
+	/*
+	 * The entries are loaded in subtransactions, which parallel mode does
+	 * not allow in the workers or in the leader. Workers only run the
+	 * functions of the query's plan; the leader preloads the entries on
+	 * its next call outside of parallel mode.
+	 */
+	if (IsInParallelMode())
+	{
+		preloaded = false;
+		return;
+	}
+#endif
+
+	ob = PyObject_CallMethod(Py_Postgres_module, "_preload_setting", "sI",
+		ext_preload, (unsigned int) fn_oid);
+	if (ob == NULL)
+		PyErr_ThrowPostgresError("could not preload the functions listed by \"python.preload\"");
+	Py_DECREF(ob);
+}
+
 static void
 increment_xact_count(void)
 {
@@ -135,9 +300,26 @@ xact_hook(XactEvent xev, void *arg)
 
 	switch (xev)
 	{
+#if PG_VERSION_NUM >= 90300
+		/*
+		 * Issue the queued notifications while NOTIFY is still possible.
+		 */
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			notify_flush();
+		break;
+#endif
+
 		case XACT_EVENT_COMMIT:
 		case XACT_EVENT_PREPARE:
 		case XACT_EVENT_ABORT:
+#if PG_VERSION_NUM >= 90500
+		/*
+		 * Parallel workers end their transactions with these events.
+		 */
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_PARALLEL_ABORT:
+#endif
 		{
 			/*
 			 * Restore the count after GC has run.
@@ -189,6 +371,21 @@ xact_hook(XactEvent xev, void *arg)
 				 * it anyways as arbitrary code is being ran.
 				 * [think ob.__del__()]
 				 */
+				/*
+				 * The aggregates' memory is gone with the transaction.
+				 */
+				agg_release_all();
+
+				/*
+				 * Left over when the transaction aborted.
+				 */
+				notify_discard();
+
+				/*
+				 * The errors of the transaction have been reported.
+				 */
+				discard_deferred_tracebacks();
+
 				rob = PyObject_CallMethod(Py_Postgres_module, "_xact_exit", "");
 				if (rob != NULL)
 					Py_DECREF(rob);
@@ -206,12 +403,19 @@ xact_hook(XactEvent xev, void *arg)
 
 			PG_TRY();
 			{
+				instr_time start, end;
+
 				/*
 				 * *Very* unlikely to error out, but protect anyways as this
 				 * can execute arbitrary code.
 				 */
+				INSTR_TIME_SET_CURRENT(start);
 				PySet_Clear(TransactionScope);
 				PyGC_Collect();
+				INSTR_TIME_SET_CURRENT(end);
+
+				INSTR_TIME_ACCUM_DIFF(pl_stats.st_xact_collect, end, start);
+				++(pl_stats.st_xact_collections);
 			}
 			PG_CATCH();
 			{
@@ -480,6 +684,13 @@ _PG_init(void)
 
 	Py_DECREF(ob);
 
+	code_cache_init();
+	pl_stats_init();
+	shared_init();
+	notify_init();
+	worker_init();
+	settings_init();
+
 	RegisterXactCallback(xact_hook, NULL);
 	on_proc_exit(exit_hook, (Datum) 0); /* Calls Postgres._exit */
 
@@ -38,12 +38,14 @@
 #include "pypg/pl.h"
 #include "pypg/extension.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
 #include "pypg/type/type.h"
 #include "pypg/type/object.h"
 #include "pypg/type/system.h"
 #include "pypg/type/record.h"
 #include "pypg/tupledesc.h"
 #include "pypg/function.h"
+#include "pypg/codecache.h"
 
 PyObj Py_builtins_module = NULL;
 PyObj Py_compile_ob = NULL;
@@ -70,6 +72,8 @@ PyPgFunction_get_source(PyObj func)
 
 /*
  * PyPgFunction_get_code - compile the code from the source
+ *
+ * The code cache is consulted first, and newly compiled code is stored in it.
  */
 PyObj
 PyPgFunction_get_code(PyObj func)
@@ -91,9 +95,19 @@ PyPgFunction_get_code(PyObj func)
 		return(NULL);
 	}
 
+	rob = code_cache_load(func);
+	if (rob != NULL)
+	{
+		Py_DECREF(prosrc);
+		return(rob);
+	}
+
 	cargs = PyTuple_New(3);
 	if (cargs == NULL)
+	{
+		Py_DECREF(prosrc);
 		return(NULL);
+	}
 
 	PyTuple_SET_ITEM(cargs, 0, prosrc);
 	PyTuple_SET_ITEM(cargs, 1, PyPgFunction_GetFilename(func));
@@ -104,6 +118,9 @@ PyPgFunction_get_code(PyObj func)
 	rob = PyObject_CallObject(Py_compile_ob, cargs);
 	Py_DECREF(cargs);
 
+	if (rob != NULL)
+		code_cache_store(func, rob);
+
 	return(rob);
 }
 
@@ -598,6 +615,8 @@ static PyMemberDef PyPgFunction_Members[] = {
 	PyDoc_STR("the function's results")},
 	{"stateful", T_BOOL, offsetof(struct PyPgFunction, fn_stateful), 0,
 	PyDoc_STR("the function returns a send'able iterator(generator)")},
+	{"returns_set", T_BOOL, offsetof(struct PyPgFunction, fn_retset), READONLY,
+	PyDoc_STR("the function is declared to return a set(SETOF)")},
 	{NULL,}
 };
 
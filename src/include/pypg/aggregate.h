@@ -0,0 +1,75 @@
+/*
+ * Aggregate transition state
+ */
+#ifndef PyPg_aggregate_H
+#define PyPg_aggregate_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AGG_CONTEXT_AGGREGATE
+/* 8.4; AggCheckCallContext's results */
+#define AGG_CONTEXT_AGGREGATE 1
+#define AGG_CONTEXT_WINDOW 2
+#endif
+
+/*
+ * Whether the function is being called by an aggregate(or window aggregate).
+ *
+ * Returns AGG_CONTEXT_AGGREGATE or AGG_CONTEXT_WINDOW and sets *aggcontext
+ * when it is, otherwise zero.
+ */
+int agg_call_context(FunctionCallInfo fcinfo, MemoryContext *aggcontext);
+
+/*
+ * Get the Python object held by an "internal" state Datum.
+ *
+ * Returns a borrowed reference, None for a NULL pointer, or NULL with a
+ * Python exception set when the state was not created by agg_set_state.
+ */
+PyObj agg_get_state(Datum d);
+
+/*
+ * Hold the Python object as the aggregate's state.
+ *
+ * The structure referenced by the previous state Datum is reused; a new one
+ * is allocated in aggcontext for the first row. Returns the state Datum.
+ *
+ * ON ERROR: Python exception, (Datum) 0
+ */
+Datum agg_set_state(MemoryContext aggcontext, Datum previous, bool previous_isnull, PyObj state);
+
+/*
+ * Release the Python object held by the state Datum.
+ */
+void agg_release_state(Datum d);
+
+/*
+ * Whether the state can be released after the final function is called.
+ * Always false on 9.6 and later, where states may be shared.
+ */
+bool agg_state_is_final(FunctionCallInfo fcinfo, int aggkind);
+
+/*
+ * The size of the memory given to agg_init_state.
+ */
+Size agg_state_size(void);
+
+/*
+ * Use the given memory, agg_state_size() bytes, as the state structure.
+ *
+ * The memory must be a zeroed chunk allocated by palloc when it is first
+ * used; window functions use the partition's local memory. Returns the state Datum for agg_get_state,
+ * agg_set_state, and agg_release_state.
+ */
+Datum agg_init_state(void *mem);
+
+/*
+ * Release all aggregate states; called at the end of the transaction.
+ */
+void agg_release_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_aggregate_H */
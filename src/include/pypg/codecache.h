@@ -0,0 +1,36 @@
+/*
+ * Persistent cache of compiled function modules
+ */
+#ifndef PyPg_codecache_H
+#define PyPg_codecache_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * python.code_cache_directory
+ *
+ * When set, marshalled code objects are read from and written to this
+ * directory. Empty string disables the cache.
+ */
+extern char *pl_code_cache_directory;
+
+void code_cache_init(void);
+
+/*
+ * Get the function's code object from the cache.
+ *
+ * Returns a new reference, or NULL without an exception set when the code
+ * is not available in the cache.
+ */
+PyObj code_cache_load(PyObj func);
+
+/*
+ * Store the function's compiled code in the cache. Failures are ignored.
+ */
+void code_cache_store(PyObj func, PyObj code);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_codecache_H */
@@ -14,6 +14,11 @@ extern "C" {
 #define CUR_SCROLL_BACKWARD -1
 #define CUR_UNINITIALIZED 0
 
+/*
+ * Number of rows read ahead by __next__ on scrollable cursors.
+ */
+#define CUR_READ_AHEAD 50
+
 typedef struct PyPgCursor {
 	PyObject_HEAD
 	PyObj cur_statement;		/* PyPgStatement object */
@@ -38,7 +43,22 @@ typedef struct PyPgCursor {
 	unsigned long cur_xid;
 
 	Portal cur_portal;
-	PyObj cur_buffer; /* Iterable used for rows() cursors */
+	PyObj cur_buffer; /* Iterable used for rows() and declare() cursors */
+
+	/*
+	 * For declare() cursors, the number of rows in cur_buffer that have not
+	 * been returned, and whether the read that filled it reached the end of
+	 * the Portal. The Portal is positioned ahead of the cursor by that many
+	 * rows(plus one at the end).
+	 */
+	Py_ssize_t cur_ahead;
+	bool cur_at_edge;
+
+	/*
+	 * WITH HOLD; the Portal survives the commit of the transaction that
+	 * opened it.
+	 */
+	bool cur_hold;
 } * PyPgCursor;
 
 extern PyTypeObject PyPgCursor_Type;
@@ -47,14 +67,16 @@ PyObj PyPgCursor_NEW(
 	PyTypeObject *subtype,
 	PyObj statement,
 	PyObj args, PyObj kw,
-	Py_ssize_t chunksize);
+	Py_ssize_t chunksize,
+	bool hold);
 
 /*
  * Close the cursor.
  */
 int PyPgCursor_Close(PyObj self);
 
-#define PyPgCursor_New(STMT, ARGS, KW, CS) PyPgCursor_NEW(&PyPgCursor_Type, STMT, ARGS, KW, CS)
+#define PyPgCursor_New(STMT, ARGS, KW, CS) PyPgCursor_NEW(&PyPgCursor_Type, STMT, ARGS, KW, CS, false)
+#define PyPgCursor_NewHeld(STMT, ARGS, KW, CS) PyPgCursor_NEW(&PyPgCursor_Type, STMT, ARGS, KW, CS, true)
 
 #define PyPgCursor_Check(SELF) (PyObject_TypeCheck(SELF, &PyPgCursor_Type))
 #define PyPgCursor_CheckExact(SELF) (Py_TYPE(SELF) == &PyPgCursor_Type)
@@ -67,6 +89,9 @@ int PyPgCursor_Close(PyObj self);
 #define PyPgCursor_GetPortal(SELF) (((PyPgCursor) SELF)->cur_portal)
 #define PyPgCursor_GetBuffer(SELF) (((PyPgCursor) SELF)->cur_buffer)
 #define PyPgCursor_GetName(SELF) (((PyPgCursor) SELF)->cur_name)
+#define PyPgCursor_GetAhead(SELF) (((PyPgCursor) SELF)->cur_ahead)
+#define PyPgCursor_GetAtEdge(SELF) (((PyPgCursor) SELF)->cur_at_edge)
+#define PyPgCursor_IsHeld(SELF) (((PyPgCursor) SELF)->cur_hold)
 
 #define PyPgCursor_SetStatement(SELF, STMT) (((PyPgCursor) SELF)->cur_statement = STMT)
 #define PyPgCursor_SetParameters(SELF, PARAMS) (((PyPgCursor) SELF)->cur_parameters = PARAMS)
@@ -76,6 +101,9 @@ int PyPgCursor_Close(PyObj self);
 #define PyPgCursor_SetPortal(SELF, PORT) (((PyPgCursor) SELF)->cur_portal = PORT)
 #define PyPgCursor_SetBuffer(SELF, BUF) (((PyPgCursor) SELF)->cur_buffer = BUF)
 #define PyPgCursor_SetName(SELF, NAMESTR) (((PyPgCursor) SELF)->cur_name = NAMESTR)
+#define PyPgCursor_SetAhead(SELF, N) (((PyPgCursor) SELF)->cur_ahead = N)
+#define PyPgCursor_SetAtEdge(SELF, B) (((PyPgCursor) SELF)->cur_at_edge = B)
+#define PyPgCursor_SetHeld(SELF, B) (((PyPgCursor) SELF)->cur_hold = B)
 
 /* Scrollable */
 #define PyPgCursor_IsDeclared(SELF) (PyPgCursor_GetChunksize(SELF) == 1 || PyPgCursor_GetChunksize(SELF) == -1)
@@ -90,9 +118,15 @@ int PyPgCursor_Close(PyObj self);
 #define PyPgCursor_GetRowsReadSize(SELF) ((-PyPgCursor_GetChunksize(SELF)) - 2)
 #define PyPgCursor_GetDirection(SELF) (PyPgCursor_GetChunksize(SELF) == -1 ? false : true)
 
+/*
+ * Held cursors are only valid in later transactions if the Portal was
+ * persisted; it is dropped instead when the opening transaction aborts.
+ */
 #define PyPgCursor_IsClosed(SELF) ( \
-	(PyPgCursor_GetXid(SELF) != ext_xact_count) || \
-	!PortalIsValid(PyPgCursor_GetPortal(SELF)))
+	!PortalIsValid(PyPgCursor_GetPortal(SELF)) || \
+	((PyPgCursor_GetXid(SELF) != ext_xact_count) && \
+		(!PyPgCursor_IsHeld(SELF) || \
+		SPI_cursor_find(PyPgCursor_GetName(SELF)) != PyPgCursor_GetPortal(SELF))))
 
 #ifdef __cplusplus
 }
@@ -11,6 +11,8 @@ extern "C" {
 struct pl_exec_state;
 
 void error_init_tracebacks(void);
+char *expand_deferred_tracebacks(const char *context);
+void discard_deferred_tracebacks(void);
 
 extern PyObj PYSTR(pg_errordata);
 extern PyObj PYSTR(pg_inhibit_pl_context);
@@ -20,11 +22,15 @@ extern PyObj PyExc_PostgresException;
 /*
  * Should appear in a condition before most PG_TRY() blocks accessible from
  * Python.
+ *
+ * Also starts any deferred ISTs (see ist.h) as the database is about to be
+ * accessed.
  */
 #define DB_IS_NOT_READY() \
 	(ext_state == xact_failed ? PyErr_SetInFailedTransaction() : ( \
-	(ext_state != ext_ready ? PyErr_SetDatabaseAccessDenied() : ext_state \
-)))
+	(ext_state != ext_ready ? PyErr_SetDatabaseAccessDenied() : ( \
+	(ist_pending != 0 ? !ist_start_pending() : false) \
+))))
 
 /*
  * Returns true on success and false when a Python exception is set.
@@ -51,6 +51,29 @@ typedef enum {
 
 extern extension_state_t ext_state;
 
+/*
+ * python.isolation
+ *
+ * When set to "role", the Python environment is reset by ext_isolate() when
+ * a transaction runs as a different role than the one before it.
+ */
+typedef enum {
+	ext_isolation_none = 0,
+	ext_isolation_role,
+} ext_isolation_t;
+
+extern int ext_isolation;
+void ext_isolate(void);
+
+/*
+ * python.preload
+ *
+ * Schemas and function signatures whose modules are loaded by the first
+ * function call in the backend.
+ */
+extern char *ext_preload;
+void ext_preload_functions(Oid fn_oid);
+
 #ifdef __cplusplus
 }
 #endif
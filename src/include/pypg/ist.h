@@ -8,12 +8,14 @@ extern "C" {
 #endif
 
 extern unsigned long ist_count; /* The current "xid". */
+extern unsigned long ist_pending; /* Deferred ISTs not yet started. */
 
 /* IST states */
 #define ist_open 'O'
 #define ist_committed 'C'
 #define ist_aborted 'X'
 #define ist_new ' '
+#define ist_deferred 'D'
 
 /*
  * Aborts the current transaction.
@@ -41,6 +43,26 @@ bool ist_commit(unsigned long xid, char state);
  */
 bool ist_begin(char state);
 
+/*
+ * Defer the start of an IST until the next database access.
+ * Returns the id that the IST will have once it is started.
+ */
+unsigned long ist_defer(void);
+
+/*
+ * Start the deferred ISTs. Called by DB_IS_NOT_READY() and ist_begin().
+ *
+ * ON ERROR: Returns false and sets a Python exception.
+ */
+bool ist_start_pending(void);
+
+/*
+ * Exit a deferred IST that was never started.
+ *
+ * ON ERROR: Returns false and sets a Python exception.
+ */
+bool ist_forget(unsigned long xid, bool commit);
+
 /*
  * Used in cases were the stored_ist_count != ist_count
  *
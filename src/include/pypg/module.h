@@ -23,9 +23,13 @@ extern PyObj Py_Postgres_module;
 	TYP(Object) \
 	TYP(String) \
 	TYP(Array) \
+	TYP(ArrayIter) \
 	TYP(Pseudo) \
 	TYP(Statement) \
 	TYP(Cursor) \
+	TYP(Window) \
+	TYP(MessageQueue) \
+	TYP(SharedVersion) \
 	END
 
 #ifdef __cplusplus
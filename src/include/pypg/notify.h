@@ -0,0 +1,55 @@
+/*
+ * Queued notifications; Postgres.queue_notify
+ */
+#ifndef PyPg_notify_H
+#define PyPg_notify_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Register the subtransaction callback that discards the notifications
+ * queued by aborted subtransactions.
+ */
+void notify_init(void);
+
+/*
+ * Queue a notification unless the same channel and payload is already queued.
+ * payload may be NULL.
+ *
+ * ON ERROR: NULL
+ */
+PyObj notify_queue(PyObj channel, PyObj payload);
+
+/*
+ * Issue the queued notifications and empty the queue.
+ *
+ * ON ERROR: ereport(ERROR)
+ */
+void notify_flush(void);
+
+/*
+ * Get a list of the queued (channel, payload) tuples in the order that they
+ * were queued.
+ *
+ * ON ERROR: NULL
+ */
+PyObj notify_queued(void);
+
+/*
+ * Empty the queue without issuing the notifications.
+ */
+void notify_discard(void);
+
+/*
+ * LISTEN or UNLISTEN the channels in the sequence. An empty sequence given to
+ * UNLISTEN stops listening on all channels.
+ *
+ * ON ERROR: NULL
+ */
+PyObj notify_listen(PyObj channels, bool listen);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_notify_H */
@@ -124,6 +124,9 @@ struct pl_fn_info {
 	PyObject *fi_internal_state;/* internal call state; td for triggers, iterator for SRFs */
 	PyObject *fi_input;			/* func->fn_input or polymorphed variant */
 	PyObject *fi_output;		/* func->fn_output or polymorphed variant */
+	struct pl_conversion_plan *fi_plan;	/* converters for fi_input and fi_output */
+
+	struct pl_fn_stats *fi_stats;	/* instrumentation; see src/stats.c */
 };
 
 /* Feed it function call info, returns the fi_state from fn_info */
@@ -44,7 +44,7 @@ do{ \
 #define PyUnicode_FromCString(CHAR) \
 	PyUnicode_FromPointerAndSize(CHAR, strlen(CHAR))
 #define PyUnicode_FromTEXT(TEXT) \
-	PyUnicode_FromPointerAndSize(VARDATA(TEXT), VARSIZE_ANY_EXHDR(TEXT))
+	PyUnicode_FromPointerAndSize(VARDATA_ANY(TEXT), VARSIZE_ANY_EXHDR(TEXT))
 
 #define Py_Require_Type(TYP, ITYP) \
 	((PyObj) ITYP == (PyObj) TYP || PyType_IsSubtype((ITYP), ((PyTypeObject *) TYP))) ? 0 : ( \
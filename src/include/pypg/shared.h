@@ -0,0 +1,64 @@
+/*
+ * Shared buffers; Postgres.shared
+ */
+#ifndef PyPg_shared_H
+#define PyPg_shared_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Maximum number of named buffers.
+ */
+#define SHARED_MAX_ENTRIES 64
+
+/*
+ * Maximum number of versions kept at once; the current versions and the
+ * replaced versions that are still viewed.
+ */
+#define SHARED_MAX_BLOCKS (SHARED_MAX_ENTRIES * 4)
+
+/*
+ * Postgres.SharedVersion; pins the version viewed by a shared buffer's
+ * memoryview.
+ */
+extern PyTypeObject PyPgSharedVersion_Type;
+
+/*
+ * Size of the shared memory region in kilobytes; python.shared_memory.
+ */
+extern int pl_shared_memory;
+
+/*
+ * Define python.shared_memory and, when loaded by shared_preload_libraries,
+ * request the shared memory region.
+ */
+void shared_init(void);
+
+/*
+ * Get a read-only memoryview of the current version of the named buffer.
+ * The version is kept until the view is released.
+ *
+ * ON ERROR: NULL, KeyError when the name has not been published.
+ */
+PyObj shared_get(PyObj name);
+
+/*
+ * Copy the object's buffer into shared memory and make it the current
+ * version of the name. Returns the version as a Python int.
+ *
+ * ON ERROR: NULL
+ */
+PyObj shared_publish(PyObj name, PyObj data);
+
+/*
+ * Get a dictionary of the published names and their (version, size) tuples.
+ *
+ * ON ERROR: NULL
+ */
+PyObj shared_entries(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_shared_H */
@@ -7,7 +7,7 @@
 extern "C" {
 #endif
 
-int execute_statements(const char *src);
+int execute_statements(const char *src, bool *single_query);
 
 typedef struct PyPgStatement {
 	PyObject_HEAD
@@ -22,6 +22,8 @@ typedef struct PyPgStatement {
 	OverrideSearchPath *ps_path;	/* Search path when the statement was created */
 	SPIPlanPtr ps_plan;				/* Saved NO SCROLL Plan */
 	SPIPlanPtr ps_scroll_plan;		/* Saved SCROLL Plan */
+	SPIPlanPtr ps_hold_plan;		/* Saved NO SCROLL WITH HOLD Plan */
+	SPIPlanPtr ps_scroll_hold_plan;	/* Saved SCROLL WITH HOLD Plan */
 } * PyPgStatement;
 
 extern PyTypeObject PyPgStatement_Type;
@@ -29,6 +31,8 @@ PyObj PyPgStatement_NEW(PyTypeObject *subtype,
 	PyObj sql_statement_string, PyObj parameters);
 SPIPlanPtr PyPgStatement_GetPlan(PyObj self);
 SPIPlanPtr PyPgStatement_GetScrollPlan(PyObj self);
+SPIPlanPtr PyPgStatement_GetHoldPlan(PyObj self, bool with_scroll);
+int execute_plan(PyObj self);
 
 #define PyPgPreparedStatment_New(STATEMENT_STRING) PyPgStatement_NEW(&PyPgStatement_Type, STATEMENT_STRING)
 
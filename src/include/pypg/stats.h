@@ -0,0 +1,123 @@
+/*
+ * Handler instrumentation
+ */
+#ifndef PyPg_stats_H
+#define PyPg_stats_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "portability/instr_time.h"
+
+/*
+ * Per-function counters and timers.
+ *
+ * Entries are allocated in TopMemoryContext and are never freed; resets only
+ * zero the fields. This allows fn_extra to hold a pointer to the entry.
+ */
+struct pl_fn_stats {
+	Oid fs_oid;					/* hash key */
+	uint64 fs_calls;			/* handler entries that returned */
+	uint64 fs_errors;			/* handler entries that raised an error */
+	uint64 fs_loads;			/* module loads performed by initialize() */
+	uint64 fs_spi_calls;		/* SPI calls made by Statements and Cursors */
+	instr_time fs_spi;			/* the SPI calls; part of fs_main or fs_initialize */
+	instr_time fs_total;		/* handler entry to exit */
+	instr_time fs_initialize;	/* initialize() */
+	instr_time fs_arguments;	/* build_args() */
+	instr_time fs_main;			/* invoke_main() */
+	instr_time fs_result;		/* result conversion */
+};
+
+/*
+ * Counters that are not associated with a particular function.
+ */
+struct pl_stats {
+	uint64 st_spi_calls;
+	instr_time st_spi;
+	uint64 st_type_cache_hits;
+	uint64 st_type_cache_misses;
+	uint64 st_xact_collections;
+	instr_time st_xact_collect;
+	uint64 st_code_cache_hits;
+	uint64 st_code_cache_misses;
+	uint64 st_resets;
+	uint64 st_subxacts;
+	uint64 st_subxacts_avoided;
+	uint64 st_subxid_overflows;
+	uint64 st_toast_deferred;
+	uint64 st_toast_detoasted;
+};
+extern struct pl_stats pl_stats;
+
+/*
+ * python.track_functions; whether the handler's timers are maintained.
+ * The counters are always maintained.
+ */
+extern bool pl_track_functions;
+
+void pl_stats_init(void);
+struct pl_fn_stats *pl_stats_function(Oid fn_oid);
+void pl_stats_reset(void);
+PyObj pl_stats_get(void);
+
+/*
+ * The stats entry of the function currently being executed, if any.
+ */
+#define PL_FN_STATS() ( \
+	(pl_execution_context == NULL || PL_FN_INFO() == NULL) ? NULL : \
+	PL_FN_INFO()->fi_stats \
+)
+
+/*
+ * Start a timer when python.track_functions is on; otherwise, zero it.
+ */
+#define PL_STATS_START(START) do { \
+	if (pl_track_functions) \
+		INSTR_TIME_SET_CURRENT(START); \
+	else \
+		INSTR_TIME_SET_ZERO(START); \
+} while(0)
+
+/*
+ * Accumulate the time since START into the given field of the current
+ * function's stats. Timers that were not started are ignored.
+ */
+#define PL_STATS_ACCUM(FIELD, START) do { \
+	struct pl_fn_stats *_fs = PL_FN_STATS(); \
+	if (_fs != NULL && !INSTR_TIME_IS_ZERO(START)) \
+	{ \
+		instr_time _end; \
+		INSTR_TIME_SET_CURRENT(_end); \
+		INSTR_TIME_ACCUM_DIFF(_fs->FIELD, _end, START); \
+	} \
+} while(0)
+
+/*
+ * Accumulate the time since START into the SPI timers of the backend and of
+ * the current function. Timers that were not started are ignored.
+ */
+#define PL_STATS_SPI_ACCUM(START) do { \
+	if (!INSTR_TIME_IS_ZERO(START)) \
+	{ \
+		struct pl_fn_stats *_fs = PL_FN_STATS(); \
+		instr_time _elapsed; \
+		INSTR_TIME_SET_CURRENT(_elapsed); \
+		INSTR_TIME_SUBTRACT(_elapsed, START); \
+		INSTR_TIME_ADD(pl_stats.st_spi, _elapsed); \
+		if (_fs != NULL) \
+			INSTR_TIME_ADD(_fs->fs_spi, _elapsed); \
+	} \
+} while(0)
+
+#define PL_STATS_SPI_CALL() do { \
+	struct pl_fn_stats *_fs = PL_FN_STATS(); \
+	++(pl_stats.st_spi_calls); \
+	if (_fs != NULL) \
+		++(_fs->fs_spi_calls); \
+} while(0)
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_stats_H */
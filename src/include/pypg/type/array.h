@@ -19,6 +19,11 @@ PyObj PyPgArray_Initialize(PyObj, ArrayType *);
 #define PyPgArray_Check(SELF) (PyObject_TypeCheck(SELF, &PyPgArray_Type))
 #define PyPgArray_CheckExact(SELF) (Py_TYPE(SELF) == &PyPgArray_Type)
 
+/*
+ * The iterator returned by Array.iter_elements()
+ */
+extern PyTypeObject PyPgArrayIter_Type;
+
 #define PyPgArray_GetArrayType(SELF) \
 	((ArrayType *) (DatumGetPointer(PyPgObject_GetDatum(SELF))))
 
@@ -19,6 +19,8 @@ PyObj PyPgObject_FromTypeOidAndDatum(Oid, Datum);
 PyObj PyPgObject_FromTypeOidAndPyObject(Oid typeoid, PyObj ob);
 
 PyObj PyPgObject_Initialize(PyObj self, Datum);
+PyObj PyPgObject_NewToasted(PyObj typ, Datum);
+int PyPgObject_Detoast(PyObj self);
 PyObj PyPgObject_Operate(const char *, PyObj, PyObj);
 
 #define PyPgObject_BODY	\
@@ -48,6 +50,17 @@ typedef struct PyPgObject {
 #define PyPgObject_GetDatum(SELF)	(PyPgObject(SELF)->pg_datum)
 #define PyPgObject_SetDatum(SELF, D) (PyPgObject(SELF)->pg_datum = D)
 
+/*
+ * True when the object holds a compressed or external varlena.
+ *
+ * Only PyPgObject_NewToasted creates such objects; every other constructor
+ * detoasts the Datum. Code that reads the varlena's data directly must call
+ * PyPgObject_Detoast first.
+ */
+#define PyPgObject_IsToasted(SELF) \
+	(PyPgTypeInfo(Py_TYPE(SELF))->typlen == -1 && \
+	VARATT_IS_EXTENDED(DatumGetPointer(PyPgObject_GetDatum(SELF))))
+
 #define PyPgObject_datumCopy(SELF) \
 	(Py_datumCopy( \
 		PyPgObject_GetDatum(rob), \
@@ -31,6 +31,13 @@ extern PyPgTypeObject PyPg_unknown_Type;
 extern PyPgTypeObject PyPg_cstring_Type;
 #define PyPg_cstring_Type_oid CSTRINGOID
 
+/*
+ * Direct conversions between str and text-like Datums.
+ * See string.c for the details of what is handled.
+ */
+PyObj PyPgString_FromDatum(Oid typoid, Datum d);
+bool PyPgString_DatumFromPyUnicode(Oid typoid, PyObj ob, Datum *out);
+
 /* High-level check for arbitrary string objects */
 #define Py_String_Check(SELF) \
 	(PyUnicode_Check(SELF) || PyPgString_Check(SELF))
@@ -87,6 +87,10 @@ struct pypg_domain_data {
 	int32 typndims;
 	bool typnotnull;
 	List *constraint_list;
+	MemoryContext constraint_memory;	/* constraint_list and econtext */
+	struct ExprContext *econtext;		/* for CHECKs; created on first use */
+	unsigned long constraint_generation;	/* when constraint_list was loaded */
+	int check_depth;			/* checks using constraint_list and econtext */
 	PyObj typubase_Type; /* ultimate base type; BORROWED reference */
 };
 
@@ -0,0 +1,51 @@
+/*
+ * Postgres.Window
+ */
+#ifndef PyPg_window_H
+#define PyPg_window_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PyPgWindow {
+	PyObject_HEAD
+	WindowObject win_object;	/* NULL once the call has returned */
+	PyObj win_input;			/* the function's parameter descriptor */
+} * PyPgWindow;
+extern PyTypeObject PyPgWindow_Type;
+
+/*
+ * Create a window object for the call of a WINDOW function.
+ *
+ * The object is only usable until PyPgWindow_Invalidate is called, which the
+ * handler does as soon as main returns.
+ */
+PyObj PyPgWindow_New(WindowObject winobj, PyObj input);
+
+#if PG_VERSION_NUM < 90500
+/*
+ * Release the partition's state if the current row is its last row.
+ *
+ * Later versions release the state when the partition's memory is reset.
+ */
+void PyPgWindow_EndRow(WindowObject winobj, int nargs);
+#endif
+
+#define PyPgWindow_Check(SELF) (PyObject_TypeCheck((SELF), &PyPgWindow_Type))
+
+#define PyPgWindow_GetObject(SELF) \
+	(((PyPgWindow) SELF)->win_object)
+#define PyPgWindow_GetInput(SELF) \
+	(((PyPgWindow) SELF)->win_input)
+
+#define PyPgWindow_SetObject(SELF, WO) \
+	(((PyPgWindow) SELF)->win_object = WO)
+#define PyPgWindow_SetInput(SELF, OB) \
+	(((PyPgWindow) SELF)->win_input = OB)
+
+#define PyPgWindow_Invalidate(SELF) PyPgWindow_SetObject(SELF, NULL)
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_window_H */
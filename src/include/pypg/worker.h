@@ -0,0 +1,61 @@
+/*
+ * Background workers; python.workers and Postgres.bgworker
+ */
+#ifndef PyPg_worker_H
+#define PyPg_worker_H 0
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Seconds before the server restarts a configured worker that failed.
+ */
+#define WORKER_RESTART_INTERVAL 10
+
+/*
+ * Default size of each of a dynamic worker's queues.
+ */
+#define WORKER_QUEUE_SIZE 65536
+
+/*
+ * Postgres.MessageQueue
+ */
+extern PyTypeObject PyPgMessageQueue_Type;
+
+/*
+ * python.workers; comma separated "database:schema.function" entries.
+ */
+extern char *pl_workers;
+
+/*
+ * Define python.workers and, when loaded by shared_preload_libraries,
+ * register a worker for each entry.
+ */
+void worker_init(void);
+
+/*
+ * Start a dynamic background worker that runs the function in the current
+ * database. Returns the backend's end of the worker's queues, each of which
+ * holds queue_size bytes.
+ *
+ * ON ERROR: NULL
+ */
+PyObj worker_start(PyObj function, Py_ssize_t queue_size);
+
+/*
+ * Get the worker's end of the queues, or None outside of a dynamic worker.
+ *
+ * ON ERROR: NULL
+ */
+PyObj worker_queue(void);
+
+/*
+ * Entry points of the worker processes.
+ */
+void pl_worker_main(Datum index);
+void pl_dynamic_worker_main(Datum fn_oid);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !PyPg_worker_H */
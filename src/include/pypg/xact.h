@@ -10,6 +10,7 @@ extern "C" {
 typedef struct PyPgTransaction {
 	PyObject_HEAD
 	char state;
+	bool deferred;		/* start the IST on the first database access */
 	unsigned long id;
 } * PyPgTransaction;
 extern PyTypeObject PyPgTransaction_Type;
@@ -26,6 +27,8 @@ void pl_ist_reset(unsigned long number_to_abort);
 	(PyPgTransaction(SELF)->state)
 #define PyPgTransaction_GetId(SELF) \
 	(PyPgTransaction(SELF)->id)
+#define PyPgTransaction_IsDeferred(SELF) \
+	(PyPgTransaction(SELF)->deferred)
 
 #define PyPgTransaction_SetState(SELF, NEWSTATE) \
 	PyPgTransaction(SELF)->state = NEWSTATE
@@ -13,3 +13,40 @@ CREATE FUNCTION
 RETURNS VOID LANGUAGE C AS 'python';
 
 CREATE LANGUAGE python HANDLER "pl_handler" INLINE "pl_inline" VALIDATOR "pl_validator";
+
+-- Instrumentation
+
+CREATE FUNCTION
+"python_stats" (
+	OUT "function" regprocedure,
+	OUT "calls" int8,
+	OUT "errors" int8,
+	OUT "loads" int8,
+	OUT "spi_calls" int8,
+	OUT "total" float8,
+	OUT "initialize" float8,
+	OUT "arguments" float8,
+	OUT "main" float8,
+	OUT "result" float8,
+	OUT "spi" float8
+)
+RETURNS SETOF record LANGUAGE python AS
+$python$
+import Postgres
+columns = (
+	'calls', 'errors', 'loads', 'spi_calls',
+	'total', 'initialize', 'arguments', 'main', 'result', 'spi',
+)
+def main():
+	for oid, fs in Postgres.stats()['functions'].items():
+		yield (oid,) + tuple(fs[x] for x in columns)
+$python$;
+
+CREATE FUNCTION
+"python_reset_stats" ()
+RETURNS VOID LANGUAGE python AS
+$python$
+import Postgres
+def main():
+	Postgres.reset_stats()
+$python$;
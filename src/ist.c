@@ -18,18 +18,57 @@
 #include "utils/builtins.h"
 #include "catalog/pg_type.h"
 #include "executor/spi.h"
+#include "storage/proc.h"
 
 #include "pypg/python.h"
 #include "pypg/pl.h"
 #include "pypg/extension.h"
 #include "pypg/error.h"
 #include "pypg/ist.h"
+#include "pypg/stats.h"
 
 /*
  * Count of open ISTs.
  */
 unsigned long ist_count = 0;
 
+/*
+ * Count of deferred ISTs that have been entered, but not started.
+ * They are started, in order, by the next database access.
+ */
+unsigned long ist_pending = 0;
+
+/*
+ * Whether the backend's subtransaction XID cache has overflowed. Once it
+ * has, other backends must consult pg_subtrans to check our XIDs for the
+ * remainder of the transaction.
+ */
+#if PG_VERSION_NUM >= 90200
+#define SUBXIDS_OVERFLOWED() (ProcGlobal->allPgXact[MyProc->pgprocno].overflowed)
+#else
+#define SUBXIDS_OVERFLOWED() (MyProc->subxids.overflowed)
+#endif
+
+/*
+ * The transaction that the overflow was last counted in.
+ */
+static unsigned long overflow_xact_count = 0;
+
+/*
+ * Count the overflow once per transaction. Called before an IST exits as
+ * the XIDs are assigned while it is open.
+ */
+static void
+check_subxid_overflow(void)
+{
+	if (MyProc != NULL && SUBXIDS_OVERFLOWED()
+		&& overflow_xact_count != ext_xact_count)
+	{
+		overflow_xact_count = ext_xact_count;
+		++(pl_stats.st_subxid_overflows);
+	}
+}
+
 bool
 ist_abort(unsigned long xid, char state)
 {
@@ -76,6 +115,7 @@ ist_abort(unsigned long xid, char state)
 			));
 		}
 
+		check_subxid_overflow();
 		ist_count = ist_count - 1;
 		RollbackAndReleaseCurrentSubTransaction();
 
@@ -161,6 +201,7 @@ ist_commit(unsigned long xid, char state)
 				));
 			}
 
+			check_subxid_overflow();
 			ist_count = ist_count - 1;
 			ReleaseCurrentSubTransaction();
 		}
@@ -182,6 +223,12 @@ ist_begin(char state)
 {
 	bool r = true;
 
+	/*
+	 * Deferred ISTs that enclose this one need to be started first.
+	 */
+	if (ist_pending != 0 && !ist_start_pending())
+		return(false);
+
 	PG_TRY();
 	{
 		/* Prevent wrap around */
@@ -217,6 +264,49 @@ ist_begin(char state)
 
 		BeginInternalSubTransaction(NULL);
 		ist_count = ist_count + 1;
+		++(pl_stats.st_subxacts);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(true);
+		ext_state = xact_failed;
+		r = false;
+	}
+	PG_END_TRY();
+
+	return(r);
+}
+
+unsigned long
+ist_defer(void)
+{
+	ist_pending = ist_pending + 1;
+	return(ist_count + ist_pending);
+}
+
+bool
+ist_start_pending(void)
+{
+	bool r = true;
+
+	PG_TRY();
+	{
+		/* Prevent wrap around */
+		if (ist_count + ist_pending < ist_count)
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_SAVEPOINT_EXCEPTION),
+				errmsg("too many internal subtransactions")
+			));
+		}
+
+		while (ist_pending > 0)
+		{
+			BeginInternalSubTransaction(NULL);
+			ist_count = ist_count + 1;
+			ist_pending = ist_pending - 1;
+			++(pl_stats.st_subxacts);
+		}
 	}
 	PG_CATCH();
 	{
@@ -229,6 +319,45 @@ ist_begin(char state)
 	return(r);
 }
 
+bool
+ist_forget(unsigned long xid, bool commit)
+{
+	if (xid != ist_count + ist_pending)
+	{
+		PG_TRY();
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_SAVEPOINT_EXCEPTION),
+				errmsg("out-of-order exit attempted on subtransaction %lu", xid),
+				errdetail("Subtransaction %lu was expected to exit next.",
+					ist_count + ist_pending)
+			));
+		}
+		PG_CATCH();
+		{
+			PyErr_SetPgError(true);
+		}
+		PG_END_TRY();
+
+		return(false);
+	}
+
+	ist_pending = ist_pending - 1;
+	++(pl_stats.st_subxacts_avoided);
+
+	/*
+	 * Without a subtransaction, there is nothing to recover an error state
+	 * with, so a commit must report it.
+	 */
+	if (commit && ext_state)
+	{
+		PyErr_SetInFailedTransaction();
+		return(false);
+	}
+
+	return(true);
+}
+
 /*
  * ist_reset - Abort the given number of ISTs and set a Python error.
  *
@@ -9,6 +9,7 @@
 #include "postgres.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "windowapi.h"
 #include "access/heapam.h"
 #include "access/htup.h"
 #include "access/hio.h"
@@ -52,6 +53,7 @@
 #include "pypg/module.h"
 #include "pypg/pl.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
 #include "pypg/errordata.h"
 #include "pypg/triggerdata.h"
 
@@ -71,6 +73,11 @@
 #include "pypg/statement.h"
 #include "pypg/cursor.h"
 #include "pypg/stateful.h"
+#include "pypg/window.h"
+#include "pypg/stats.h"
+#include "pypg/shared.h"
+#include "pypg/notify.h"
+#include "pypg/worker.h"
 
 /*
  * The source to the pure-Python portion of the 'Postgres' module.
@@ -553,6 +560,58 @@ py_notify(PyObj self, PyObj args)
 }
 #endif /* notify with or without payload */
 
+static PyObj
+py_queue_notify(PyObj self, PyObj args)
+{
+	PyObj channel, payload = NULL;
+
+	if (!PyArg_ParseTuple(args, "O|O:queue_notify", &channel, &payload))
+		return(NULL);
+
+	return(notify_queue(channel, payload));
+}
+
+static PyObj
+py_flush_notify(PyObj self)
+{
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	PG_TRY();
+	{
+		notify_flush();
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	Py_INCREF(Py_None);
+	return(Py_None);
+}
+
+static PyObj
+py_queued_notifies(PyObj self)
+{
+	return(notify_queued());
+}
+
+static PyObj
+py_listen(PyObj self, PyObj args)
+{
+	return(notify_listen(args, true));
+}
+
+static PyObj
+py_unlisten(PyObj self, PyObj args)
+{
+	return(notify_listen(args, false));
+}
+
 static PyObj
 pypg_uid(void)
 {
@@ -711,9 +770,20 @@ py_lo_create(PyObj self, PyObj args)
 	return(PyLong_FromOid(lo_oid));
 }
 
+/*
+ * Execute the statements in the string. When prepare is True and the string
+ * is a single query, it is not executed and True is returned; the caller
+ * prepares and executes it.
+ */
 static PyObj
-py_execute(PyObj self, PyObj sql_str)
+py_execute(PyObj self, PyObj args)
 {
+	volatile bool single_query = false;
+	PyObj sql_str, prepare = NULL;
+
+	if (!PyArg_ParseTuple(args, "O|O:_execute", &sql_str, &prepare))
+		return(NULL);
+
 	if (PL_FN_READONLY())
 	{
 		PyErr_SetString(PyExc_RuntimeError, "cannot execute from a non-volatile function");
@@ -731,7 +801,11 @@ py_execute(PyObj self, PyObj sql_str)
 	SPI_push();
 	PG_TRY();
 	{
-		execute_statements(PyBytes_AS_STRING(sql_str));
+		bool sq;
+
+		execute_statements(PyBytes_AS_STRING(sql_str),
+			prepare == Py_True ? &sq : NULL);
+		single_query = prepare == Py_True && sq;
 	}
 	PG_CATCH();
 	{
@@ -743,6 +817,33 @@ py_execute(PyObj self, PyObj sql_str)
 	SPI_pop();
 
 	Py_DECREF(sql_str);
+	return(PyBool_FromLong(single_query));
+}
+
+/*
+ * Execute a parameterless Postgres.Statement to completion.
+ */
+static PyObj
+py_execute_plan(PyObj self, PyObj stmt)
+{
+	if (!PyPgStatement_Check(stmt))
+	{
+		PyErr_SetString(PyExc_TypeError, "_execute_plan requires a Postgres.Statement");
+		return(NULL);
+	}
+
+	if (PL_FN_READONLY())
+	{
+		PyErr_SetString(PyExc_RuntimeError, "cannot execute from a non-volatile function");
+		return(NULL);
+	}
+
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	if (execute_plan(stmt))
+		return(NULL);
+
 	Py_INCREF(Py_None);
 	return(Py_None);
 }
@@ -809,37 +910,55 @@ py_lo_open(PyObj self, PyObj args)
 	return(PyLong_FromLong((long) fd));
 }
 
+/*
+ * Any object supporting the buffer protocol is written directly; no copy is
+ * made.
+ */
 static PyObj
 py_lo_write(PyObj self, PyObj args)
 {
-	int fd, len, status;
-	char *data;
+	int fd, status;
+	Py_buffer data;
 
 	if (DB_IS_NOT_READY())
 		return(NULL);
 
-	if (!PyArg_ParseTuple(args, "iy#:_lo_write", &fd, &data, &len))
+	if (!PyArg_ParseTuple(args, "iy*:_lo_write", &fd, &data))
 		return(NULL);
 
+	if (data.len > INT_MAX)
+	{
+		PyBuffer_Release(&data);
+		PyErr_SetString(PyExc_OverflowError,
+			"cannot write more than INT_MAX bytes at once");
+		return(NULL);
+	}
+
 	PG_TRY();
 	{
-		status = lo_write(fd, data, (int) len);
+		status = lo_write(fd, (char *) data.buf, (int) data.len);
 	}
 	PG_CATCH();
 	{
+		PyBuffer_Release(&data);
 		PyErr_SetPgError(false);
 		return(NULL);
 	}
 	PG_END_TRY();
 
+	PyBuffer_Release(&data);
 	return(PyLong_FromLong((long) status));
 }
 
+/*
+ * The data is read directly into the bytes object.
+ */
 static PyObj
 py_lo_read(PyObj self, PyObj args)
 {
 	int fd, len;
-	PyObj rob = NULL;
+	volatile int readbytes = 0;
+	PyObj rob;
 
 	if (DB_IS_NOT_READY())
 		return(NULL);
@@ -847,27 +966,70 @@ py_lo_read(PyObj self, PyObj args)
 	if (!PyArg_ParseTuple(args, "ii:_lo_read", &fd, &len))
 		return(NULL);
 
-	PG_TRY();
+	if (len < 0)
 	{
-		char *buf;
-		int readbytes;
+		PyErr_SetString(PyExc_ValueError, "read length must be non-negative");
+		return(NULL);
+	}
 
-		buf = palloc(len);
-		readbytes = lo_read(fd, buf, len);
-		rob = PyBytes_FromStringAndSize(buf, readbytes);
-		pfree(buf);
+	rob = PyBytes_FromStringAndSize(NULL, (Py_ssize_t) len);
+	if (rob == NULL)
+		return(NULL);
+
+	PG_TRY();
+	{
+		readbytes = lo_read(fd, PyBytes_AS_STRING(rob), len);
 	}
 	PG_CATCH();
 	{
-		Py_XDECREF(rob);
-		rob = NULL;
+		Py_DECREF(rob);
 		PyErr_SetPgError(false);
+		return(NULL);
 	}
 	PG_END_TRY();
 
+	if (readbytes != len)
+	{
+		if (_PyBytes_Resize(&rob, (Py_ssize_t) readbytes))
+			return(NULL);
+	}
+
 	return(rob);
 }
 
+/*
+ * Read into the given writable buffer; returns the number of bytes read.
+ */
+static PyObj
+py_lo_readinto(PyObj self, PyObj args)
+{
+	int fd;
+	volatile int readbytes = 0;
+	Py_buffer buf;
+
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	if (!PyArg_ParseTuple(args, "iw*:_lo_readinto", &fd, &buf))
+		return(NULL);
+
+	PG_TRY();
+	{
+		readbytes = lo_read(fd, (char *) buf.buf,
+			(int) Min(buf.len, (Py_ssize_t) INT_MAX));
+	}
+	PG_CATCH();
+	{
+		PyBuffer_Release(&buf);
+		PyErr_SetPgError(false);
+		return(NULL);
+	}
+	PG_END_TRY();
+
+	PyBuffer_Release(&buf);
+	return(PyLong_FromLong((long) readbytes));
+}
+
 static PyObj
 py_lo_close(PyObj self, PyObj args)
 {
@@ -968,11 +1130,83 @@ py_cleartypecache(PyObj self)
 	return(Py_None);
 }
 
+static PyObj
+py_stats(PyObj self)
+{
+	return(pl_stats_get());
+}
+
+static PyObj
+py_reset_stats(PyObj self)
+{
+	pl_stats_reset();
+	Py_INCREF(Py_None);
+	return(Py_None);
+}
+
+static PyObj
+py_shared_get(PyObj self, PyObj name)
+{
+	return(shared_get(name));
+}
+
+static PyObj
+py_shared_publish(PyObj self, PyObj args)
+{
+	PyObj name, data;
+
+	if (!PyArg_ParseTuple(args, "OO", &name, &data))
+		return(NULL);
+
+	return(shared_publish(name, data));
+}
+
+static PyObj
+py_shared_entries(PyObj self)
+{
+	return(shared_entries());
+}
+
+static PyObj
+py_bgworker(PyObj self, PyObj args, PyObj kw)
+{
+	static char *words[] = {"function", "queue_size", NULL};
+	PyObj function;
+	Py_ssize_t queue_size = WORKER_QUEUE_SIZE;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "O|n:bgworker", words,
+			&function, &queue_size))
+		return(NULL);
+
+	return(worker_start(function, queue_size));
+}
+
+static PyObj
+py_bgworker_queue(PyObj self)
+{
+	return(worker_queue());
+}
+
 static PyMethodDef PyPgModule_Methods[] = {
 	{"_memstats", (PyCFunction) py_memstats, METH_NOARGS,
 		PyDoc_STR("print PythonMemoryContext stats to stderr")},
 	{"_cleartypecache", (PyCFunction) py_cleartypecache, METH_NOARGS,
 		PyDoc_STR("clear the type cache dictionary")},
+	{"stats", (PyCFunction) py_stats, METH_NOARGS,
+		PyDoc_STR("get the handler's counters and timers")},
+	{"reset_stats", (PyCFunction) py_reset_stats, METH_NOARGS,
+		PyDoc_STR("zero the handler's counters and timers")},
+
+	{"_shared_get", (PyCFunction) py_shared_get, METH_O,
+		PyDoc_STR("get a memoryview of the current version of a shared buffer")},
+	{"_shared_publish", (PyCFunction) py_shared_publish, METH_VARARGS,
+		PyDoc_STR("publish a new version of a shared buffer")},
+	{"_shared_entries", (PyCFunction) py_shared_entries, METH_NOARGS,
+		PyDoc_STR("get the (version, size) of each shared buffer")},
+	{"bgworker", (PyCFunction) py_bgworker, METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("start a background worker that calls the function until it returns None")},
+	{"bgworker_queue", (PyCFunction) py_bgworker_queue, METH_NOARGS,
+		PyDoc_STR("get the queue to the backend that started this worker")},
 
 	{"__get_Postgres_source__", (PyCFunction) py_get_Postgres_source, METH_NOARGS,
 		PyDoc_STR("get the Python source to the Postgres module")},
@@ -1010,8 +1244,20 @@ static PyMethodDef PyPgModule_Methods[] = {
 
 	{"notify", (PyCFunction) py_notify, METH_VARARGS,
 		PyDoc_STR("synonym for NOTIFY \"...\"")},
-	{"execute", (PyCFunction) py_execute, METH_O,
-	PyDoc_STR("execute multiple SQL statements; always returns None")},
+	{"queue_notify", (PyCFunction) py_queue_notify, METH_VARARGS,
+		PyDoc_STR("queue a notification to be issued once before the transaction commits")},
+	{"flush_notify", (PyCFunction) py_flush_notify, METH_NOARGS,
+		PyDoc_STR("issue the queued notifications now")},
+	{"queued_notifies", (PyCFunction) py_queued_notifies, METH_NOARGS,
+		PyDoc_STR("get the queued (channel, payload) tuples")},
+	{"listen", (PyCFunction) py_listen, METH_VARARGS,
+		PyDoc_STR("synonym for LISTEN \"...\" on each channel")},
+	{"unlisten", (PyCFunction) py_unlisten, METH_VARARGS,
+		PyDoc_STR("synonym for UNLISTEN \"...\" on each channel; UNLISTEN * without channels")},
+	{"_execute", (PyCFunction) py_execute, METH_VARARGS,
+	PyDoc_STR("execute multiple SQL statements; returns whether a single query was left to prepare")},
+	{"_execute_plan", (PyCFunction) py_execute_plan, METH_O,
+	PyDoc_STR("execute the parameterless statement to completion")},
 
 	{"uid", (PyCFunction) pypg_uid, METH_NOARGS,
 	PyDoc_STR("get the current UserId")},
@@ -1029,6 +1275,8 @@ static PyMethodDef PyPgModule_Methods[] = {
 	PyDoc_STR("write the data to the opened large object")},
 	{"_lo_read", (PyCFunction) py_lo_read, METH_VARARGS,
 	PyDoc_STR("read data from the opened large object")},
+	{"_lo_readinto", (PyCFunction) py_lo_readinto, METH_VARARGS,
+	PyDoc_STR("read data from the opened large object into a writable buffer")},
 	{"_lo_close", (PyCFunction) py_lo_close, METH_VARARGS,
 	PyDoc_STR("close the large object")},
 	{"_lo_tell", (PyCFunction) py_lo_tell, METH_VARARGS,
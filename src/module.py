@@ -7,6 +7,7 @@ import io
 import functools
 import warnings
 import types as py_types
+import collections
 
 class StringModule(object):
 	"""
@@ -168,6 +169,51 @@ def preload(*args, pg_language_oid = None, _query = _preload_get_procs):
 			z.load_module()
 del _preload_get_procs # keep module namespace clean
 
+def _split_preload_setting(setting):
+	"""
+	Split the python.preload setting on the commas that are not inside the
+	parameter list of a function signature.
+	"""
+	depth = 0
+	start = 0
+	for i, c in enumerate(setting):
+		if c == '(':
+			depth += 1
+		elif c == ')':
+			depth -= 1
+		elif c == ',' and depth == 0:
+			yield setting[start:i].strip()
+			start = i + 1
+	yield setting[start:].strip()
+
+def _preload_setting(setting, fn_oid):
+	"""
+	Load the schemas and functions listed in python.preload.
+
+	Called by the first function call in the backend. Entries that fail to
+	load are reported as WARNINGs so that the call itself can proceed.
+	"""
+	lanoid = Function(fn_oid).language
+	regproc = Type(CONST["REGPROCEDUREOID"])
+	for x in _split_preload_setting(setting):
+		if not x:
+			continue
+		try:
+			with Transaction():
+				if '(' in x:
+					Function(regproc(x)).load_module()
+				else:
+					preload(x, pg_language_oid = lanoid)
+		# Exception is redefined as Postgres.Exception below.
+		except __builtins__.Exception as err:
+			WARNING(
+				'could not preload "%s"' % (x,),
+				detail = getattr(err, 'message', None) or str(err),
+				hint = 'Check the "python.preload" setting.',
+			)
+		else:
+			DEBUG('preloaded "%s"' % (x,))
+
 ##
 # Override stdio objects to give the client information
 # about what is happening. Likely, stdio operations indicate
@@ -212,7 +258,7 @@ sys.stdin = StandardIn("sys.stdin")
 #  ...
 #
 _pytypes_map = {
-	CONST['BYTEAOID'] : bytes,
+	CONST['BYTEAOID'] : memoryview,
 	CONST['BOOLOID'] : bool,
 	CONST['INT2OID'] : int,
 	CONST['INT4OID'] : int,
@@ -251,8 +297,191 @@ class pytypes(tuple):
 	def __call__(self, *args, **kw):
 		return self[0](*convert_postgres_objects(args), **kw)
 
+class Batch(object):
+	"""
+	Decorator for column-at-a-time entry points.
+
+	The decorated object is given one list per parameter and returns a
+	sequence of results of the same length. Values of the common types, such
+	as integers and floats, are given as builtin objects. When the function
+	is declared to return a set, each parameter is an array holding a batch
+	of values and the results are returned as the set; otherwise, the call is
+	a batch of one.
+	"""
+
+	__slots__ = ('source',)
+
+	def __init__(self, source):
+		self.source = source
+
+	def __call__(self, *args):
+		func = __get_func__()
+		if func is not None and func.returns_set:
+			columns = [[] if x is None else x.tolist(native = True) for x in args]
+			n = len(columns[0]) if columns else 0
+			for x in columns:
+				if len(x) != n:
+					raise ValueError("batch parameters must have the same number of elements")
+			if n == 0:
+				return ()
+			results = list(self.source(*columns))
+			if len(results) != n:
+				raise ValueError(
+					"batch of {0} produced {1} results".format(n, len(results)))
+			return results
+
+		results = list(self.source(*[[x] for x in convert_postgres_objects(args)]))
+		if len(results) != 1:
+			raise ValueError(
+				"batch of 1 produced {0} results".format(len(results)))
+		return results[0]
+
+class PlanCache(object):
+	"""
+	Bounded cache of the statements prepared by `eval` and `execute`.
+
+	Entries are keyed by the SQL and the Oids of the search_path at the time
+	of the call, and the least recently used entry is dropped when `size` is
+	exceeded. Setting `size` to zero disables the cache.
+	"""
+
+	def __init__(self, size = 64):
+		self._entries = collections.OrderedDict()
+		self._size = size
+		self.hits = 0
+		self.misses = 0
+
+	@property
+	def size(self):
+		return self._size
+
+	@size.setter
+	def size(self, size):
+		size = int(size)
+		if size < 0:
+			raise ValueError("plan cache size must not be negative")
+		self._size = size
+		self._trim()
+
+	def __len__(self):
+		return len(self._entries)
+
+	def _trim(self):
+		while len(self._entries) > self._size:
+			self._entries.popitem(last = False)
+
+	def key(self, kind, sql):
+		return (kind, sql, current_schemas_oid(True))
+
+	def get(self, key):
+		ps = self._entries.pop(key, None)
+		if ps is None:
+			self.misses += 1
+		else:
+			self.hits += 1
+			self._entries[key] = ps
+		return ps
+
+	def add(self, key, ps):
+		if self._size > 0:
+			self._entries[key] = ps
+			self._trim()
+
+	def clear(self):
+		"""
+		Drop all the cached statements and reset the counters.
+		"""
+		self._entries.clear()
+		self.hits = 0
+		self.misses = 0
+
+	def info(self):
+		return {
+			'size': self._size,
+			'entries': len(self._entries),
+			'hits': self.hits,
+			'misses': self.misses,
+		}
+
+plan_cache = PlanCache()
+
+class Shared(object):
+	"""
+	Read-only buffers shared by all the backends of the server.
+
+	Indexing returns a memoryview of the current version of the named buffer.
+	The views refer directly to shared memory, and the data of a version is
+	kept until its last view is released, so they remain valid after a new
+	version is published.
+	"""
+
+	__slots__ = ()
+
+	def __getitem__(self, name):
+		return _shared_get(name)
+
+	def get(self, name, default = None):
+		try:
+			return _shared_get(name)
+		except KeyError:
+			return default
+
+	def __contains__(self, name):
+		return name in _shared_entries()
+
+	def __iter__(self):
+		return iter(_shared_entries())
+
+	def __len__(self):
+		return len(_shared_entries())
+
+	def keys(self):
+		return _shared_entries().keys()
+
+	def version(self, name):
+		"""
+		The version of the named buffer; incremented by every publication.
+		"""
+		return _shared_entries()[name][0]
+
+	def publish(self, name, data):
+		"""
+		Copy the object's buffer into shared memory as the new version of the
+		named buffer. Returns the version.
+		"""
+		return _shared_publish(name, data)
+
+shared = Shared()
+
 def eval(sql, *args):
-	return Statement('SELECT (' + str(sql) + ');', *args).first()
+	"""
+	Evaluate the SQL expression and return the result. The additional
+	arguments are the values of the expression's parameters.
+	"""
+	sql = str(sql)
+	key = plan_cache.key('eval', sql)
+	ps = plan_cache.get(key)
+	if ps is None:
+		ps = Statement('SELECT (' + sql + ');')
+		plan_cache.add(key, ps)
+	return ps.first(*args)
+
+def execute(sql):
+	"""
+	Execute the SQL statements in the string; always returns None.
+
+	Strings that consist of a single query are prepared and cached in
+	`plan_cache` so that subsequent executions are not parsed again.
+	"""
+	key = plan_cache.key('execute', sql)
+	ps = plan_cache.get(key)
+	if ps is None:
+		if not _execute(sql, plan_cache.size > 0):
+			return
+		# A single query was left to be prepared; plan it once, here.
+		ps = Statement(sql)
+		plan_cache.add(key, ps)
+	_execute_plan(ps)
 
 class Types(object):
 	__name__ = 'Postgres.types'
@@ -367,17 +596,26 @@ class Exception(Exception):
 		else:
 			return ''
 
-class LargeObject(io.IOBase):
+class LargeObject(io.RawIOBase):
 	"""
 	Python interface to Postgres LargeObjects.
 
 	Depends on the the _lo_* built-ins created by the C-portion of the Postgres
 	module.
+
+	This is a raw I/O object; wrap it with io.BufferedReader for efficient
+	small reads.
 	"""
 	_INV_READ = CONST["INV_READ"]
 	_INV_WRITE = CONST["INV_WRITE"]
 
 	closed = None
+	# Size of the reads performed by chunks(), and the largest made by readline().
+	block_size = 1024 * 64
+	# Size of the first read made by readline().
+	_line_size = 128
+	# lo_read takes an int; larger reads are made in block_size chunks.
+	_read_max = 0x7FFFFFFF
 
 	def fileno(self):
 		raise IOError("LargeObject's do not have an underlying file descriptor")
@@ -413,7 +651,7 @@ class LargeObject(io.IOBase):
 		oid = _lo_create()
 		return cls(oid, mode = 'rwt')
 
-	def __init__(self, oid, mode = 'r'):
+	def __init__(self, oid, mode = 'r', block_size = None):
 		mc = 0
 		for m in mode:
 			if m == 'r':
@@ -429,46 +667,93 @@ class LargeObject(io.IOBase):
 		self.lod = _lo_open(oid, mc)
 		self.mode = mode
 		self.oid = oid
+		if block_size is not None:
+			self.block_size = block_size
 		self.closed = False
 
 	def read(self, quantity = None):
 		if self.closed is not False:
 			raise ValueError('operation on closed LargeObject')
 		lod = self.lod
-		if quantity is None:
-			# read everything
-			string = io.BytesIO()
-			data = _lo_read(lod, 1024)
-			while len(data) == 1024:
-				string.write(data)
-				data = _lo_read(lod, 1024)
-			string.write(data)
-			string.seek(0)
-			return string.read()
-		# otherwise, directly read the specified amount
-		return _lo_read(lod, quantity)
-
-	def readline(self):
+		if quantity is None or quantity < 0:
+			# read everything; find the remaining size and read it at once
+			position = _lo_tell(lod)
+			end = _lo_seek(lod, 0, 2)
+			_lo_seek(lod, position, 0)
+			quantity = max(end - position, 0)
+		if quantity <= self._read_max:
+			# directly read the specified amount
+			return _lo_read(lod, quantity)
+
+		parts = []
+		while quantity > 0:
+			data = _lo_read(lod, min(quantity, self.block_size))
+			if not data:
+				break
+			parts.append(data)
+			quantity -= len(data)
+		return b''.join(parts)
+
+	readall = read
+
+	def readinto(self, buffer):
+		"""
+		Read directly into the given writable buffer. Returns the number of
+		bytes read.
+		"""
+		if self.closed is not False:
+			raise ValueError('operation on closed LargeObject')
+		return _lo_readinto(self.lod, buffer)
+
+	def chunks(self, size = None):
+		"""
+		Iterate over the remaining data in blocks of the given size,
+		`block_size` by default.
+		"""
+		if self.closed is not False:
+			raise ValueError('operation on closed LargeObject')
+		lod = self.lod
+		size = size or self.block_size
+		data = _lo_read(lod, size)
+		while data:
+			yield data
+			if len(data) < size:
+				break
+			data = _lo_read(lod, size)
+
+	def readline(self, limit = -1):
+		"""
+		Read up to and including the next newline. The first read is
+		`_line_size` bytes, and each following read is twice the size of the
+		last, up to `block_size`; the position is then moved back to the byte
+		after the newline.
+		"""
 		if self.closed is not False:
 			raise ValueError('operation on closed LargeObject')
 
 		lod = self.lod
-		line_data = b''
-		data = _lo_read(lod, 100)
-		while not b'\n' in data:
-			line_data = line_data + data
-			data = _lo_read(lod, 100)
-			if not data:
+		size = min(self._line_size, self.block_size)
+		parts = []
+		total = 0
+		while True:
+			if limit is not None and limit >= 0:
+				if total >= limit:
+					break
+				size = min(size, limit - total)
+			data = _lo_read(lod, size)
+			nloffset = data.find(b'\n')
+			if nloffset != -1:
+				if nloffset + 1 < len(data):
+					# seek relative, back to the position after the newline
+					self.seek(-(len(data) - nloffset - 1), 1)
+				parts.append(data[:nloffset+1])
 				break
-		line_data = line_data + data
-		nloffset = line_data.find(b'\n')
-		if nloffset != -1:
-			# seek relative, back to the nloffset
-			self.seek(-(len(line_data) - nloffset - 1), 1)
-			# include the newline
-			return line_data[:nloffset+1]
-		else:
-			return line_data
+			parts.append(data)
+			total += len(data)
+			if len(data) < size:
+				break
+			size = min(size * 2, self.block_size)
+		return b''.join(parts)
 
 	def __iter__(self):
 		return self
@@ -546,10 +831,11 @@ def _clearfunccache():
 
 def clearcache():
 	"""
-	Clear the function and type caches.
+	Clear the function, type, and plan caches.
 	"""
 	_clearfunccache()
 	_cleartypecache()
+	plan_cache.clear()
 	try:
 		import linecache
 		linecache.clearcache()
@@ -589,6 +875,59 @@ def _entry():
 	__builtins__.sqleval = eval
 	__builtins__.sqlexec = execute
 
+	_take_baseline()
+
+##
+# The state restored by reset(). Taken once the module has been initialized.
+_baseline = None
+
+def _take_baseline():
+	global _baseline
+	names = dict(globals())
+	_baseline = (
+		frozenset(sys.modules),
+		dict(__builtins__.__dict__),
+		list(sys.path),
+		names,
+	)
+	# Restoring the names must not forget the baseline.
+	names['_baseline'] = _baseline
+
+def reset():
+	"""
+	Restore the environment to the state it was in after initialization.
+
+	Function modules and any modules imported since are removed from
+	sys.modules, and the builtins, sys.path, and the names of the Postgres
+	module are restored. The Postgres module, the type cache, and the modules
+	loaded by init.py are kept.
+	"""
+	if _baseline is None:
+		return
+	modules, builtins, path, names = _baseline
+
+	for k in [k for k in sys.modules if k not in modules]:
+		del sys.modules[k]
+
+	bd = __builtins__.__dict__
+	for k in [k for k in bd if k not in builtins]:
+		del bd[k]
+	bd.update(builtins)
+
+	sys.path[:] = path
+
+	g = globals()
+	for k in [k for k in g if k not in names]:
+		del g[k]
+	g.update(names)
+
+	plan_cache.clear()
+	try:
+		import linecache
+		linecache.clearcache()
+	except ImportError:
+		pass
+
 # execute the init.py file relative to the cluster
 def _init(module, initfile = "init.py", eval = __builtins__.eval, ModuleType = py_types.ModuleType):
 	import os.path
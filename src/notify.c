@@ -0,0 +1,415 @@
+/*
+ * Queued notifications; Postgres.queue_notify
+ *
+ * Functions that signal many changes in a transaction often NOTIFY the same
+ * channel and payload repeatedly. Postgres.notify issues every one of them,
+ * and Async_Notify compares each notification with the ones that are already
+ * pending in the transaction. The notifications queued here are deduplicated
+ * with a dictionary, and issued once: before the transaction commits on 9.3
+ * and later, and when the handler returns on earlier versions that do not
+ * have a pre-commit callback.
+ *
+ * Notifications queued by a subtransaction are discarded when it aborts, as
+ * NOTIFY's are.
+ */
+#include <setjmp.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "access/xact.h"
+#include "commands/async.h"
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/extension.h"
+#include "pypg/error.h"
+#include "pypg/notify.h"
+
+/*
+ * {(channel, payload) : SubTransactionId that queued it}
+ */
+static PyObj notify_pending = NULL;
+
+/*
+ * The keys of notify_pending in the order they were queued.
+ */
+static PyObj notify_order = NULL;
+
+/*
+ * Rewrite the subtransaction ids of the notifications queued by mySubid.
+ * When parentSubid is InvalidSubTransactionId, the notifications are removed.
+ */
+static int
+notify_reassign(SubTransactionId mySubid, SubTransactionId parentSubid)
+{
+	PyObj order, subid, parent = NULL;
+	Py_ssize_t i;
+
+	subid = PyLong_FromUnsignedLong((unsigned long) mySubid);
+	if (subid == NULL)
+		return(-1);
+
+	if (parentSubid != InvalidSubTransactionId)
+	{
+		parent = PyLong_FromUnsignedLong((unsigned long) parentSubid);
+		if (parent == NULL)
+		{
+			Py_DECREF(subid);
+			return(-1);
+		}
+	}
+
+	order = PyList_New(0);
+	if (order == NULL)
+		goto fail;
+
+	for (i = 0; i < PyList_GET_SIZE(notify_order); ++i)
+	{
+		PyObj key = PyList_GET_ITEM(notify_order, i);
+		PyObj owner = PyDict_GetItem(notify_pending, key);
+		int r;
+
+		r = PyObject_RichCompareBool(owner, subid, Py_EQ);
+		if (r == -1)
+			goto fail;
+
+		if (r && parent == NULL)
+		{
+			if (PyDict_DelItem(notify_pending, key) == -1)
+				goto fail;
+			continue;
+		}
+
+		if (r && PyDict_SetItem(notify_pending, key, parent) == -1)
+			goto fail;
+
+		if (PyList_Append(order, key) == -1)
+			goto fail;
+	}
+
+	Py_DECREF(notify_order);
+	notify_order = order;
+	Py_DECREF(subid);
+	Py_XDECREF(parent);
+	return(0);
+
+fail:
+	Py_XDECREF(order);
+	Py_DECREF(subid);
+	Py_XDECREF(parent);
+	return(-1);
+}
+
+static void
+notify_subxact_hook(SubXactEvent ev,
+	SubTransactionId mySubid, SubTransactionId parentSubid, void *arg)
+{
+	int r = 0;
+
+	if (notify_order == NULL || PyList_GET_SIZE(notify_order) == 0)
+		return;
+
+	switch (ev)
+	{
+		case SUBXACT_EVENT_COMMIT_SUB:
+			r = notify_reassign(mySubid, parentSubid);
+		break;
+
+		case SUBXACT_EVENT_ABORT_SUB:
+			r = notify_reassign(mySubid, InvalidSubTransactionId);
+		break;
+
+		default:
+		break;
+	}
+
+	if (r == -1)
+	{
+		PyErr_Clear();
+		ereport(WARNING,(
+			errmsg("could not update the queued notifications at the end of a subtransaction")
+		));
+	}
+}
+
+void
+notify_init(void)
+{
+	RegisterSubXactCallback(notify_subxact_hook, NULL);
+}
+
+PyObj
+notify_queue(PyObj channel, PyObj payload)
+{
+	PyObj key, subid;
+	int r;
+
+#if PG_VERSION_NUM < 80500
+	if (payload != NULL)
+	{
+		PyErr_SetString(PyExc_NotImplementedError,
+			"payload given to Postgres.queue_notify, but backend does not support payloads");
+		return(NULL);
+	}
+#endif
+
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	if (notify_pending == NULL)
+	{
+		notify_pending = PyDict_New();
+		if (notify_pending == NULL)
+			return(NULL);
+	}
+
+	if (notify_order == NULL)
+	{
+		notify_order = PyList_New(0);
+		if (notify_order == NULL)
+			return(NULL);
+	}
+
+	/*
+	 * Check the arguments now rather than when the queue is flushed.
+	 */
+	Py_INCREF(channel);
+	PyObject_StrBytes(&channel);
+	if (channel == NULL)
+		return(NULL);
+
+	if (PyBytes_GET_SIZE(channel) == 0 || PyBytes_GET_SIZE(channel) >= NAMEDATALEN)
+	{
+		Py_DECREF(channel);
+		PyErr_Format(PyExc_ValueError,
+			"channel names must be between 1 and %d bytes long", NAMEDATALEN - 1);
+		return(NULL);
+	}
+
+	if (payload == NULL || payload == Py_None)
+	{
+		payload = Py_None;
+		Py_INCREF(payload);
+	}
+	else
+	{
+		Py_INCREF(payload);
+		PyObject_StrBytes(&payload);
+		if (payload == NULL)
+		{
+			Py_DECREF(channel);
+			return(NULL);
+		}
+
+#if PG_VERSION_NUM >= 80500
+		if (PyBytes_GET_SIZE(payload) >= NOTIFY_PAYLOAD_MAX_LENGTH)
+		{
+			Py_DECREF(channel);
+			Py_DECREF(payload);
+			PyErr_Format(PyExc_ValueError,
+				"payloads must be shorter than %d bytes", NOTIFY_PAYLOAD_MAX_LENGTH);
+			return(NULL);
+		}
+#endif
+	}
+
+	key = PyTuple_Pack(2, channel, payload);
+	Py_DECREF(channel);
+	Py_DECREF(payload);
+	if (key == NULL)
+		return(NULL);
+
+	/*
+	 * Already queued by this subtransaction or one of its parents.
+	 */
+	r = PyDict_Contains(notify_pending, key);
+	if (r != 0)
+	{
+		Py_DECREF(key);
+		if (r == -1)
+			return(NULL);
+
+		Py_INCREF(Py_None);
+		return(Py_None);
+	}
+
+	subid = PyLong_FromUnsignedLong((unsigned long) GetCurrentSubTransactionId());
+	if (subid == NULL)
+	{
+		Py_DECREF(key);
+		return(NULL);
+	}
+
+	r = PyDict_SetItem(notify_pending, key, subid);
+	Py_DECREF(subid);
+	if (r == 0)
+	{
+		r = PyList_Append(notify_order, key);
+		if (r == -1)
+			PyDict_DelItem(notify_pending, key);
+	}
+	Py_DECREF(key);
+
+	if (r == -1)
+		return(NULL);
+
+	Py_INCREF(Py_None);
+	return(Py_None);
+}
+
+void
+notify_flush(void)
+{
+	PyObj order = notify_order;
+	Py_ssize_t i;
+
+	if (order == NULL || PyList_GET_SIZE(order) == 0)
+		return;
+
+	/*
+	 * Take the queue first so a failure does not issue them again.
+	 */
+	notify_order = NULL;
+	PyDict_Clear(notify_pending);
+
+	PG_TRY();
+	{
+		for (i = 0; i < PyList_GET_SIZE(order); ++i)
+		{
+			PyObj key = PyList_GET_ITEM(order, i);
+			PyObj channel = PyTuple_GET_ITEM(key, 0);
+#if PG_VERSION_NUM >= 80500
+			PyObj payload = PyTuple_GET_ITEM(key, 1);
+
+			Async_Notify(PyBytes_AS_STRING(channel),
+				payload == Py_None ? NULL : PyBytes_AS_STRING(payload));
+#else
+			Async_Notify(PyBytes_AS_STRING(channel));
+#endif
+		}
+	}
+	PG_CATCH();
+	{
+		Py_DECREF(order);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	Py_DECREF(order);
+}
+
+PyObj
+notify_queued(void)
+{
+	PyObj rob;
+	Py_ssize_t i, n;
+
+	n = notify_order == NULL ? 0 : PyList_GET_SIZE(notify_order);
+	rob = PyList_New(n);
+	if (rob == NULL)
+		return(NULL);
+
+	for (i = 0; i < n; ++i)
+	{
+		PyObj key = PyList_GET_ITEM(notify_order, i);
+		PyObj payload = PyTuple_GET_ITEM(key, 1);
+		PyObj item;
+
+		if (payload == Py_None)
+			item = Py_BuildValue("(NO)",
+				PyUnicode_FromCString(PyBytes_AS_STRING(PyTuple_GET_ITEM(key, 0))),
+				Py_None);
+		else
+			item = Py_BuildValue("(NN)",
+				PyUnicode_FromCString(PyBytes_AS_STRING(PyTuple_GET_ITEM(key, 0))),
+				PyUnicode_FromCString(PyBytes_AS_STRING(payload)));
+
+		if (item == NULL)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+		PyList_SET_ITEM(rob, i, item);
+	}
+
+	return(rob);
+}
+
+void
+notify_discard(void)
+{
+	if (notify_pending != NULL)
+		PyDict_Clear(notify_pending);
+
+	if (notify_order != NULL)
+	{
+		PyObj order = notify_order;
+		notify_order = NULL;
+		Py_DECREF(order);
+	}
+}
+
+PyObj
+notify_listen(PyObj channels, bool listen)
+{
+	PyObj names;
+	Py_ssize_t i;
+
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	names = PyList_New(PySequence_Length(channels));
+	if (names == NULL)
+		return(NULL);
+
+	for (i = 0; i < PyList_GET_SIZE(names); ++i)
+	{
+		PyObj name = PySequence_GetItem(channels, i);
+
+		if (name == NULL)
+		{
+			Py_DECREF(names);
+			return(NULL);
+		}
+
+		PyObject_StrBytes(&name);
+		if (name == NULL)
+		{
+			Py_DECREF(names);
+			return(NULL);
+		}
+		PyList_SET_ITEM(names, i, name);
+	}
+
+	PG_TRY();
+	{
+		if (!listen && PyList_GET_SIZE(names) == 0)
+			Async_UnlistenAll();
+
+		for (i = 0; i < PyList_GET_SIZE(names); ++i)
+		{
+			char *name = PyBytes_AS_STRING(PyList_GET_ITEM(names, i));
+
+			if (listen)
+				Async_Listen(name);
+			else
+				Async_Unlisten(name);
+		}
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	Py_DECREF(names);
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	Py_INCREF(Py_None);
+	return(Py_None);
+}
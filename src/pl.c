@@ -14,6 +14,7 @@
 #include "libpq/libpq-be.h"
 #include "libpq/pqsignal.h"
 #include "miscadmin.h"
+#include "windowapi.h"
 #include "access/htup.h"
 #include "access/heapam.h"
 #include "access/xact.h"
@@ -52,6 +53,8 @@
 #include "pypg/errcodes.h"
 #include "pypg/error.h"
 #include "pypg/ist.h"
+#include "pypg/aggregate.h"
+#include "pypg/window.h"
 #include "pypg/type/type.h"
 #include "pypg/type/object.h"
 #include "pypg/type/record.h"
@@ -65,8 +68,10 @@
 #include "pypg/tupledesc.h"
 #include "pypg/statement.h"
 #include "pypg/cursor.h"
+#include "pypg/notify.h"
 #include "pypg/module.h"
 #include "pypg/xact.h"
+#include "pypg/stats.h"
 
 struct pl_exec_state *pl_execution_context = NULL;
 
@@ -245,19 +250,194 @@ get_PyPgFunction_from_oid(Oid fn_oid, PyObj *module)
 	return(func);
 }
 
+/*
+ * Conversion plans
+ *
+ * The converters for a function's arguments and result are chosen from the
+ * parameter and result types when fn_info is initialized, so the call path
+ * does not dispatch on the type of every value.
+ */
+typedef PyObj (*pl_arg_converter)(PyObj typ, Datum d);
+
+struct pl_conversion_plan {
+	int cp_nargs;
+	PyObj *cp_types;			/* borrowed from fi_input */
+	pl_arg_converter *cp_args;	/* NULL for internal arguments */
+
+	/*
+	 * Results whose Python type is cp_result_type are given directly to
+	 * cp_result_new; anything else goes through PyPgType_DatumNew.
+	 */
+	PyTypeObject *cp_result_type;
+	pypg_new_datum cp_result_new;
+};
+
+/*
+ * Pass-by-value Datums need not be copied.
+ */
+static PyObj
+arg_byval(PyObj typ, Datum d)
+{
+	PyObj rob;
+
+	rob = PyPgObject_NEW(typ);
+	if (rob != NULL)
+		PyPgObject_SetDatum(rob, d);
+
+	return(rob);
+}
+
+static PyObj
+arg_byref(PyObj typ, Datum d)
+{
+	return(PyPgObject_New(typ, d));
+}
+
+/*
+ * str results for text-like types skip typinput when the encoding allows.
+ */
+static void
+str_new_datum(PyObj subtype, PyObj ob, int32 mod, Datum *out, bool *isnull)
+{
+	if (PyPgString_DatumFromPyUnicode(PyPgType_GetOid(subtype), ob, out))
+		*isnull = false;
+	else
+		PyPgType_typinput(subtype, ob, mod, out, isnull);
+}
+
+/*
+ * create_conversion_plan - choose the converters for the function's types
+ *
+ * The plan is allocated in the given context; the types it references are
+ * borrowed from input, so it is only valid while fn_info is.
+ */
+static struct pl_conversion_plan *
+create_conversion_plan(MemoryContext mcxt, PyObj input, PyObj output)
+{
+	struct pl_conversion_plan *plan;
+	int i, nargs = PyPgTupleDesc_GetNatts(input);
+
+	plan = MemoryContextAlloc(mcxt, sizeof(struct pl_conversion_plan)
+		+ (sizeof(PyObj) + sizeof(pl_arg_converter)) * nargs);
+	plan->cp_nargs = nargs;
+	plan->cp_types = (PyObj *) (plan + 1);
+	plan->cp_args = (pl_arg_converter *) (plan->cp_types + nargs);
+
+	for (i = 0; i < nargs; ++i)
+	{
+		PyObj typ = PyPgTupleDesc_GetAttributeType(input, i);
+
+		plan->cp_types[i] = typ;
+		if (PyPgType_GetOid(typ) == INTERNALOID)
+			plan->cp_args[i] = NULL;
+		else if (PyPgType_Get_typbyval(typ))
+			plan->cp_args[i] = arg_byval;
+		else if (PyPgType_Get_typlen(typ) == -1)
+			plan->cp_args[i] = PyPgObject_NewToasted;
+		else
+			plan->cp_args[i] = arg_byref;
+	}
+
+	plan->cp_result_type = NULL;
+	plan->cp_result_new = NULL;
+	switch (PyPgType_GetOid(output))
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			plan->cp_result_type = &PyLong_Type;
+			plan->cp_result_new = PyPgType_GetDatumNew(output);
+		break;
+
+		case FLOAT4OID:
+		case FLOAT8OID:
+			plan->cp_result_type = &PyFloat_Type;
+			plan->cp_result_new = PyPgType_GetDatumNew(output);
+		break;
+
+		case BOOLOID:
+			plan->cp_result_type = &PyBool_Type;
+			plan->cp_result_new = PyPgType_GetDatumNew(output);
+		break;
+
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case NAMEOID:
+			plan->cp_result_type = &PyUnicode_Type;
+			plan->cp_result_new = str_new_datum;
+		break;
+	}
+	if (plan->cp_result_new == NULL)
+		plan->cp_result_type = NULL;
+
+	return(plan);
+}
+
+/*
+ * build_args - create the arguments tuple
+ *
+ * When called by an aggregate, "internal" arguments are the aggregate's state
+ * and are given as the Python objects held by it.
+ */
 static PyObj
-build_args(PyObj input, int nargs, Datum *arg, bool *argnull)
+build_args(PyObj input, int nargs, Datum *arg, bool *argnull, bool aggregate,
+	struct pl_conversion_plan *plan)
 {
 	PyObj rob;
+	instr_time start;
 
 	SXD("building arguments");
+	PL_STATS_START(start);
 
 	/*
 	 * elog as this expects proper argument counts.
 	 */
-	if (PyObject_Length(input) != nargs)
+	if (plan != NULL ? plan->cp_nargs != nargs : PyObject_Length(input) != nargs)
 		elog(ERROR, "invalid number of argument for Python function");
 
+	if (plan != NULL)
+	{
+		int i;
+
+		rob = PyTuple_New(nargs);
+		if (rob == NULL)
+			PyErr_ThrowPostgresError(
+				"failed to create arguments tuple for function invocation");
+
+		for (i = 0; i < nargs; ++i)
+		{
+			PyObj ob;
+
+			if (argnull[i])
+			{
+				ob = Py_None;
+				Py_INCREF(ob);
+			}
+			else if (plan->cp_args[i] != NULL)
+				ob = plan->cp_args[i](plan->cp_types[i], arg[i]);
+			else if (aggregate)
+			{
+				ob = agg_get_state(arg[i]);
+				Py_XINCREF(ob);
+			}
+			else
+				ob = PyPgObject_New(plan->cp_types[i], arg[i]);
+
+			if (ob == NULL)
+			{
+				Py_DECREF(rob);
+				PyErr_ThrowPostgresError(
+					"failed to build arguments for function invocation");
+			}
+
+			PyTuple_SET_ITEM(rob, i, ob);
+		}
+
+		PL_STATS_ACCUM(fs_arguments, start);
+		return(rob);
+	}
+
 	rob = PyTuple_New(nargs);
 	if (rob == NULL)
 		PyErr_ThrowPostgresError(
@@ -284,7 +464,13 @@ build_args(PyObj input, int nargs, Datum *arg, bool *argnull)
 					Py_DECREF(rob);
 					PyErr_ThrowPostgresError("failed to lookup argument type");
 				}
-				ob = PyPgObject_New(typ, arg[i]);
+				if (aggregate && PyPgType_GetOid(typ) == INTERNALOID)
+				{
+					ob = agg_get_state(arg[i]);
+					Py_XINCREF(ob);
+				}
+				else
+					ob = PyPgObject_NewToasted(typ, arg[i]);
 			}
 			if (ob == NULL)
 			{
@@ -297,9 +483,59 @@ build_args(PyObj input, int nargs, Datum *arg, bool *argnull)
 		}
 	}
 
+	PL_STATS_ACCUM(fs_arguments, start);
+
 	return(rob);
 }
 
+/*
+ * detoast_arguments - detoast the arguments that outlive the call
+ *
+ * build_args leaves toasted bytea and text arguments toasted. The toast
+ * pointers are only valid while the call's snapshot is, so any argument that
+ * is still referenced after main returns--stored in a global, held by a
+ * generator or a traceback--is detoasted before leaving the handler.
+ *
+ * When main raised, its exception is preserved and detoast failures are
+ * ignored. Otherwise, returns -1 with a Python exception set on failure.
+ */
+static int
+detoast_arguments(PyObj args, bool failed)
+{
+	PyObj exc = NULL, val = NULL, tb = NULL;
+	Py_ssize_t i;
+	bool shared = Py_REFCNT(args) > 1;
+	int r = 0;
+
+	if (failed)
+		PyErr_Fetch(&exc, &val, &tb);
+
+	for (i = 0; i < PyTuple_GET_SIZE(args); ++i)
+	{
+		PyObj ob = PyTuple_GET_ITEM(args, i);
+
+		if (ob == Py_None || !PyPgObject_IsToasted(ob))
+			continue;
+		if (!shared && Py_REFCNT(ob) == 1)
+			continue;
+
+		if (PyPgObject_Detoast(ob) == -1)
+		{
+			if (!failed)
+			{
+				r = -1;
+				break;
+			}
+			PyErr_Clear();
+		}
+	}
+
+	if (failed)
+		PyErr_Restore(exc, val, tb);
+
+	return(r);
+}
+
 /*
  * invoke the "main" object in the given module object using the given args
  */
@@ -307,6 +543,7 @@ static PyObj
 invoke_main(PyObj module, PyObj args)
 {
 	PyObj main_ob, rob;
+	instr_time start;
 
 	/*
 	 * Yes, get the attribute everytime.
@@ -322,8 +559,15 @@ invoke_main(PyObj module, PyObj args)
 
 	SXD("executing main");
 
+	PL_STATS_START(start);
 	rob = PyObject_CallObject(main_ob, args);
+	PL_STATS_ACCUM(fs_main, start);
 	Py_DECREF(main_ob);
+	if (detoast_arguments(args, rob == NULL) == -1)
+	{
+		Py_DECREF(rob);
+		rob = NULL;
+	}
 	Py_DECREF(args);
 
 	SXD(NULL);
@@ -745,21 +989,31 @@ pull_trigger(PG_FUNCTION_ARGS)
 }
 
 static Datum
-create_result_datum(PyObj output, PyObj rob, bool *isnull)
+create_result_datum(PyObj output, PyObj rob, bool *isnull,
+	struct pl_conversion_plan *plan)
 {
 	Datum rd;
 	MemoryContext former = CurrentMemoryContext;
 	bool dont_free = false;
+	instr_time start;
 
 	Assert(output != NULL);
 	Assert(rob != NULL);
 	Assert(isnull != NULL);
 
 	SXD("creating result");
+	PL_STATS_START(start);
 
 	Py_ACQUIRE(rob);
 
-	if (output != (PyObj) Py_TYPE(rob))
+	if (plan != NULL && Py_TYPE(rob) == plan->cp_result_type)
+	{
+		/*
+		 * elog()'s on failure.
+		 */
+		plan->cp_result_new(output, rob, (int32) -1, &rd, isnull);
+	}
+	else if (output != (PyObj) Py_TYPE(rob))
 	{
 		/*
 		 * elog()'s on failure; Also handles the Py_None case.
@@ -795,6 +1049,8 @@ create_result_datum(PyObj output, PyObj rob, bool *isnull)
 		rd = tmpd;
 	}
 
+	PL_STATS_ACCUM(fs_result, start);
+
 	return(rd);
 }
 
@@ -1008,7 +1264,7 @@ srf_materialize(PG_FUNCTION_ARGS)
 	Assert(!PyErr_Occurred());
 
 	args = build_args(fn_info->fi_input,
-		fcinfo->nargs, fcinfo->arg, fcinfo->argnull);
+		fcinfo->nargs, fcinfo->arg, fcinfo->argnull, false, fn_info->fi_plan);
 
 	returned = invoke_main(fn_info->fi_module, args); /* DECREFs args */
 
@@ -1124,7 +1380,7 @@ srf_vpcinit(PG_FUNCTION_ARGS)
 	ReturnSetInfo *rsi = (ReturnSetInfo *) fcinfo->resultinfo;
 
 	args = build_args(fn_info->fi_input,
-		fcinfo->nargs, fcinfo->arg, fcinfo->argnull);
+		fcinfo->nargs, fcinfo->arg, fcinfo->argnull, false, fn_info->fi_plan);
 
 	rob = invoke_main(fn_info->fi_module, args); /* DECREFs args */
 
@@ -1219,7 +1475,88 @@ srf_vpcnext(PG_FUNCTION_ARGS)
 		rsi->isDone = ExprMultipleResult;
 	}
 
-	return(create_result_datum(fn_info->fi_output, rob, &(fcinfo->isnull)));
+	return(create_result_datum(fn_info->fi_output, rob, &(fcinfo->isnull),
+		fn_info->fi_plan));
+}
+
+/*
+ * Execute a WINDOW function.
+ *
+ * The arguments are not given in fcinfo; main is called with a
+ * Postgres.Window object followed by the arguments' values at the current row.
+ */
+static Datum
+call_window_function(PG_FUNCTION_ARGS)
+{
+	struct pl_fn_info *fn_info = fcinfo->flinfo->fn_extra;
+	WindowObject winobj = PG_WINDOW_OBJECT();
+	Datum *values;
+	bool *nulls;
+	int i, nargs = fcinfo->nargs;
+	PyObj win, args, cargs;
+	PyObj volatile rob = NULL;
+	Datum rd;
+
+	values = palloc(sizeof(Datum) * (nargs + 1));
+	nulls = palloc(sizeof(bool) * (nargs + 1));
+	for (i = 0; i < nargs; ++i)
+		values[i] = WinGetFuncArgCurrent(winobj, i, &nulls[i]);
+
+	cargs = build_args(fn_info->fi_input, nargs, values, nulls, false,
+		fn_info->fi_plan);
+	pfree(values);
+	pfree(nulls);
+
+	win = PyPgWindow_New(winobj, fn_info->fi_input);
+	if (win == NULL)
+	{
+		Py_DECREF(cargs);
+		PyErr_ThrowPostgresError("could not create window object");
+	}
+	Py_ACQUIRE(win);
+
+	args = PyTuple_New(nargs + 1);
+	if (args == NULL)
+	{
+		Py_DECREF(cargs);
+		PyErr_ThrowPostgresError("could not create arguments for window function");
+	}
+	PyTuple_SET_ITEM(args, 0, win);
+	Py_INCREF(win);
+	for (i = 0; i < nargs; ++i)
+	{
+		PyObj ob = PyTuple_GET_ITEM(cargs, i);
+		PyTuple_SET_ITEM(args, i + 1, ob);
+		Py_INCREF(ob);
+	}
+	Py_DECREF(cargs);
+
+	/*
+	 * The WindowObject is only valid during the call.
+	 */
+	PG_TRY();
+	{
+		rob = invoke_main(fn_info->fi_module, args); /* DECREFs args */
+	}
+	PG_CATCH();
+	{
+		PyPgWindow_Invalidate(win);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	PyPgWindow_Invalidate(win);
+
+	rd = create_result_datum(fn_info->fi_output, rob, &(fcinfo->isnull),
+		fn_info->fi_plan);
+
+#if PG_VERSION_NUM < 90500
+	/*
+	 * The partition's last row; its state is no longer needed.
+	 */
+	PyPgWindow_EndRow(winobj, nargs);
+#endif
+
+	return(rd);
 }
 
 /*
@@ -1229,14 +1566,70 @@ static Datum
 call_function(PG_FUNCTION_ARGS)
 {
 	struct pl_fn_info *fn_info = fcinfo->flinfo->fn_extra;
+	MemoryContext aggcontext = NULL;
+	int aggkind;
+	bool has_state;
 	PyObj args, rob = NULL;
+	Datum rd;
+
+	if (WindowObjectIsValid(fcinfo->context))
+		return(call_window_function(fcinfo));
+
+	aggkind = agg_call_context(fcinfo, &aggcontext);
+	has_state = aggkind != 0 && fcinfo->nargs > 0 && !fcinfo->argnull[0]
+		&& PyPgTupleDesc_GetAttributeTypeOid(fn_info->fi_input, 0) == INTERNALOID;
 
 	args = build_args(fn_info->fi_input,
-		fcinfo->nargs, fcinfo->arg, fcinfo->argnull);
+		fcinfo->nargs, fcinfo->arg, fcinfo->argnull, aggkind != 0,
+		fn_info->fi_plan);
 
 	rob = invoke_main(fn_info->fi_module, args); /* DECREFs args */
 
-	return(create_result_datum(fn_info->fi_output, rob, &(fcinfo->isnull)));
+	if (PyPgType_GetOid(fn_info->fi_output) != INTERNALOID)
+	{
+		rd = create_result_datum(fn_info->fi_output, rob, &(fcinfo->isnull),
+			fn_info->fi_plan);
+
+		/*
+		 * The final function of an aggregate; the state is no longer needed.
+		 */
+		if (has_state && agg_state_is_final(fcinfo, aggkind))
+		{
+			agg_release_state(fcinfo->arg[0]);
+		}
+
+		return(rd);
+	}
+
+	/*
+	 * A transition function; hold the returned object as the state.
+	 */
+	if (aggkind == 0)
+	{
+		Py_DECREF(rob);
+		ereport(ERROR,(
+			errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			errmsg("Python functions returning internal can only be called by aggregates")
+		));
+	}
+
+	if (rob == Py_None)
+	{
+		Py_DECREF(rob);
+		if (has_state)
+			agg_release_state(fcinfo->arg[0]);
+		fcinfo->isnull = true;
+		return(0);
+	}
+
+	rd = agg_set_state(aggcontext,
+		has_state ? fcinfo->arg[0] : 0, !has_state, rob);
+	Py_DECREF(rob);
+	if (rd == 0)
+		PyErr_ThrowPostgresError("could not store aggregate state");
+
+	fcinfo->isnull = false;
+	return(rd);
 }
 
 /*
@@ -1270,6 +1663,7 @@ initialize(PG_FUNCTION_ARGS)
 	{
 		if (ext_state == init_pending)
 			ext_entry();
+		ext_preload_functions(fn_oid);
 
 		if (fn_info == NULL)
 		{
@@ -1278,7 +1672,7 @@ initialize(PG_FUNCTION_ARGS)
 			 * However, if it's not NULL, assume that fn_extra has
 			 * been preserved--we'll re-initialize it.
 			 */
-			fn_info = MemoryContextAlloc(
+			fn_info = MemoryContextAllocZero(
 				fcinfo->flinfo->fn_mcxt, sizeof(struct pl_fn_info));
 			fcinfo->flinfo->fn_extra = fn_info;
 		}
@@ -1291,6 +1685,12 @@ initialize(PG_FUNCTION_ARGS)
 		fn_info->fi_state = NULL;
 		fn_info->fi_state_owner = NULL;
 		fn_info->fi_internal_state = NULL;
+		fn_info->fi_stats = pl_stats_function(fn_oid);
+		if (fn_info->fi_plan != NULL)
+		{
+			pfree(fn_info->fi_plan);
+			fn_info->fi_plan = NULL;
+		}
 
 		/*
 		 * Point the execution context at the function info.
@@ -1385,7 +1785,10 @@ initialize(PG_FUNCTION_ARGS)
 		 * In this context, it should always run the module code.
 		 */
 		if (module == NULL)
+		{
+			++(fn_info->fi_stats->fs_loads);
 			module = run_PyPgFunction_module(func); /* ereport's on failure */
+		}
 		else
 		{
 			r = Py_XACTREF(module);
@@ -1572,6 +1975,15 @@ initialize(PG_FUNCTION_ARGS)
 			}
 		}
 
+		/*
+		 * Choose the converters now that the types are known.
+		 */
+		if (!CALLED_AS_TRIGGER(fcinfo))
+		{
+			fn_info->fi_plan = create_conversion_plan(
+				fcinfo->flinfo->fn_mcxt, fn_info->fi_input, fn_info->fi_output);
+		}
+
 		/*
 		 * Used to identify that the fn_info needs to be refreshed.
 		 * (References in fn_extra are held by TransactionScope)
@@ -1591,6 +2003,31 @@ initialize(PG_FUNCTION_ARGS)
 	return(fn_info->fi_func);
 }
 
+/*
+ * check_deferred_ists - report the deferred ISTs that the function entered
+ * and did not exit
+ *
+ * They were never started, so there is nothing to abort; the caller has
+ * already restored ist_pending to the count it had on entry.
+ */
+static void
+check_deferred_ists(int elevel, unsigned long remaining)
+{
+	if (remaining == 0)
+		return;
+
+	if (elevel == WARNING)
+		HOLD_INTERRUPTS();
+	ereport(elevel,(
+		errcode(ERRCODE_SAVEPOINT_EXCEPTION),
+		errmsg("function failed to exit all subtransactions"),
+		errdetail("The %lu remaining deferred subtransactions have been discarded.",
+			remaining)
+	));
+	if (elevel == WARNING)
+		RESUME_INTERRUPTS();
+}
+
 /*
  * pl_handler - execute a Python procedure with given arguments.
  */
@@ -1600,12 +2037,13 @@ pl_handler(PG_FUNCTION_ARGS)
 {
 	Datum rd = 0;
 	PyObj func = NULL;
-	unsigned long stored_ist_count;
+	unsigned long stored_ist_count, stored_ist_pending, remaining_ist_pending;
 	volatile bool connected = false;
 	struct pl_exec_state *previous = pl_execution_context;
 	struct pl_exec_state current_exec_state = {
 		NULL, CurrentMemoryContext, NULL,
 	};
+	instr_time start, initialize_start;
 
 	PyGILState_STATE gs = NULL;
 
@@ -1614,8 +2052,15 @@ pl_handler(PG_FUNCTION_ARGS)
 	 * opened subtransactions have been closed on handler exit.
 	 */
 	stored_ist_count = ist_count;
+	/*
+	 * Deferred ISTs entered by the caller are not started by this call's
+	 * database accesses; they belong to the caller.
+	 */
+	stored_ist_pending = ist_pending;
+	ist_pending = 0;
 	pl_execution_context = &current_exec_state;
 	SXD("entering Python handler");
+	PL_STATS_START(start);
 
 	gs = PyGILState_Ensure();
 
@@ -1629,10 +2074,17 @@ pl_handler(PG_FUNCTION_ARGS)
 			SPI_connect();
 			connected = true;
 
+			/*
+			 * Reset the environment if the role has changed.
+			 */
+			ext_isolate();
+
 			/*
 			 * setup fn_extra and get the PyPgFunction object for the call
 			 */
+			PL_STATS_START(initialize_start);
 			func = initialize(fcinfo);
+			PL_STATS_ACCUM(fs_initialize, initialize_start);
 			/*
 			 * TODO: Cache the sub-handler in fn_info.
 			 */
@@ -1693,6 +2145,14 @@ pl_handler(PG_FUNCTION_ARGS)
 				}
 			}
 
+#if PG_VERSION_NUM < 90300
+			/*
+			 * There is no pre-commit callback to issue the queued
+			 * notifications, so issue them before returning.
+			 */
+			notify_flush();
+#endif
+
 			connected = false;
 			SPI_finish();
 		}
@@ -1712,12 +2172,21 @@ pl_handler(PG_FUNCTION_ARGS)
 			if (connected)
 				SPI_finish();
 
+			if (current_exec_state.fn_info != NULL
+				&& current_exec_state.fn_info->fi_stats != NULL)
+			{
+				++(current_exec_state.fn_info->fi_stats->fs_errors);
+			}
+
 			/*
 			 * It's already failing out, so only warn the user if the IST
 			 * count is off. Either the user did something wrong, or
 			 * the interpreter exited via longjmp(PL programming error).
 			 */
+			remaining_ist_pending = ist_pending;
+			ist_pending = stored_ist_pending;
 			ext_check_state(WARNING, stored_ist_count);
+			check_deferred_ists(WARNING, remaining_ist_pending);
 
 			pl_execution_context = previous;
 
@@ -1769,6 +2238,12 @@ pl_handler(PG_FUNCTION_ARGS)
 	}
 	Py_DEALLOCATE_OWNER();
 
+	if (PL_FN_STATS() != NULL)
+	{
+		++(PL_FN_STATS()->fs_calls);
+		PL_STATS_ACCUM(fs_total, start);
+	}
+
 	pl_execution_context = previous;
 
 	/*
@@ -1783,7 +2258,10 @@ pl_handler(PG_FUNCTION_ARGS)
 	 * raise an exception.
 	 */
 	PyGILState_Release(gs);
+	remaining_ist_pending = ist_pending;
+	ist_pending = stored_ist_pending;
 	ext_check_state(ERROR, stored_ist_count);
+	check_deferred_ists(ERROR, remaining_ist_pending);
 
 	return(rd);
 }
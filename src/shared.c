@@ -0,0 +1,673 @@
+/*
+ * Shared buffers; Postgres.shared
+ *
+ * When the extension is loaded by shared_preload_libraries and
+ * python.shared_memory is set, a region of that size is reserved in the
+ * server's shared memory. Superusers publish named buffers into the region,
+ * and every backend reads them as read-only memoryviews that refer directly
+ * to the shared memory.
+ *
+ * Published data is never overwritten or moved while it is in use.
+ * Publishing a name again copies the new data into a free block and points
+ * the name at it. Each view pins the block of its version, so views of the
+ * previous version held by other backends remain valid; the block of a
+ * replaced version is freed when its last pin is released. The pins of a
+ * backend are released when it exits.
+ */
+#include <setjmp.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/guc.h"
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/extension.h"
+#include "pypg/error.h"
+#include "pypg/shared.h"
+
+int pl_shared_memory = 0;
+
+struct shared_entry {
+	char se_name[NAMEDATALEN];
+	int se_block;				/* -1 until the first version is copied */
+	Size se_size;
+	uint32 se_version;
+};
+
+/*
+ * A version's space in the data area.
+ */
+struct shared_block {
+	Size sb_offset;				/* from the start of the data area */
+	Size sb_size;				/* MAXALIGN'd; zero when the block is free */
+	int sb_pins;				/* views held by backends */
+	bool sb_current;			/* being copied, or the version of an entry */
+};
+
+/*
+ * Named LWLock tranches replaced LWLockAssign in 9.6, and locks have been
+ * referred to by pointer since 9.4.
+ */
+#define SHARED_TRANCHE "pg-python shared buffers"
+
+struct shared_header {
+#if PG_VERSION_NUM >= 90400
+	LWLock *sh_lock;
+#else
+	LWLockId sh_lock;
+#endif
+	Size sh_size;				/* size of the data area */
+	Size sh_used;				/* allocated bytes of the data area */
+	uint32 sh_version;			/* last version assigned */
+	int sh_nentries;
+	struct shared_entry sh_entries[SHARED_MAX_ENTRIES];
+	struct shared_block sh_blocks[SHARED_MAX_BLOCKS];
+};
+
+#define SHARED_DATA(H) (((char *) (H)) + MAXALIGN(sizeof(struct shared_header)))
+
+static struct shared_header *shared_header = NULL;
+static shmem_startup_hook_type previous_shmem_startup_hook = NULL;
+
+/*
+ * The pins held by this backend, by block; released by shared_exit.
+ */
+static int shared_pins[SHARED_MAX_BLOCKS];
+static bool shared_exit_registered = false;
+static bool shared_exited = false;
+
+static Size
+shared_region_size(void)
+{
+	return(MAXALIGN(sizeof(struct shared_header)) + (Size) pl_shared_memory * 1024);
+}
+
+static void
+shared_startup(void)
+{
+	bool found;
+
+	if (previous_shmem_startup_hook != NULL)
+		previous_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	shared_header = ShmemInitStruct(SHARED_TRANCHE,
+		shared_region_size(), &found);
+	if (!found)
+	{
+		memset(shared_header, 0, sizeof(struct shared_header));
+#if PG_VERSION_NUM >= 90600
+		shared_header->sh_lock = &(GetNamedLWLockTranche(SHARED_TRANCHE)->lock);
+#else
+		shared_header->sh_lock = LWLockAssign();
+#endif
+		shared_header->sh_size = (Size) pl_shared_memory * 1024;
+	}
+	LWLockRelease(AddinShmemInitLock);
+}
+
+void
+shared_init(void)
+{
+	static bool defined = false;
+
+	if (defined)
+		return;
+
+#if PG_VERSION_NUM >= 90100
+	DefineCustomIntVariable("python.shared_memory",
+		"Size of the shared memory region used by Postgres.shared.",
+		"Requires the extension to be loaded by shared_preload_libraries. "
+		"Zero disables Postgres.shared.",
+		&pl_shared_memory, 0, 0, INT_MAX / 1024,
+		PGC_POSTMASTER, GUC_UNIT_KB, NULL, NULL, NULL);
+#else
+	DefineCustomIntVariable("python.shared_memory",
+		"Size of the shared memory region used by Postgres.shared.",
+		"Requires the extension to be loaded by shared_preload_libraries. "
+		"Zero disables Postgres.shared.",
+		&pl_shared_memory, 0, 0, INT_MAX / 1024,
+		PGC_POSTMASTER, GUC_UNIT_KB, NULL, NULL);
+#endif
+
+	defined = true;
+
+	if (!process_shared_preload_libraries_in_progress || pl_shared_memory <= 0)
+		return;
+
+	RequestAddinShmemSpace(shared_region_size());
+#if PG_VERSION_NUM >= 90600
+	RequestNamedLWLockTranche(SHARED_TRANCHE, 1);
+#else
+	RequestAddinLWLocks(1);
+#endif
+
+	previous_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = shared_startup;
+}
+
+/*
+ * Convert the name to the key used in the entries.
+ */
+static int
+shared_key(PyObj name, char *key)
+{
+	PyObj b;
+
+	if (!PyUnicode_Check(name))
+	{
+		PyErr_SetString(PyExc_TypeError, "shared buffer names must be str objects");
+		return(-1);
+	}
+
+	b = PyUnicode_AsUTF8String(name);
+	if (b == NULL)
+		return(-1);
+
+	if (PyBytes_GET_SIZE(b) >= NAMEDATALEN)
+	{
+		Py_DECREF(b);
+		PyErr_Format(PyExc_ValueError,
+			"shared buffer names must be shorter than %d bytes", NAMEDATALEN);
+		return(-1);
+	}
+
+	strcpy(key, PyBytes_AS_STRING(b));
+	Py_DECREF(b);
+	return(0);
+}
+
+static int
+shared_available(void)
+{
+	if (shared_header == NULL)
+	{
+		PyErr_SetString(PyExc_RuntimeError,
+			"shared buffers are not available; "
+			"load the extension with shared_preload_libraries "
+			"and set python.shared_memory");
+		return(-1);
+	}
+
+	return(0);
+}
+
+/*
+ * Expects the caller to hold the lock.
+ */
+static struct shared_entry *
+shared_find(const char *key)
+{
+	int i;
+
+	for (i = 0; i < shared_header->sh_nentries; ++i)
+	{
+		if (strcmp(shared_header->sh_entries[i].se_name, key) == 0)
+			return(&(shared_header->sh_entries[i]));
+	}
+
+	return(NULL);
+}
+
+/*
+ * Allocate a block of the given MAXALIGN'd size at the lowest offset that is
+ * not used by another block. Returns -1 when there is no free slot or space.
+ *
+ * Expects the caller to hold the lock exclusively.
+ */
+static int
+shared_allocate(Size size)
+{
+	struct shared_block *blocks = shared_header->sh_blocks;
+	int i, j, slot = -1;
+	Size offset = 0;
+	bool found = false;
+
+	for (i = 0; i < SHARED_MAX_BLOCKS; ++i)
+	{
+		if (blocks[i].sb_size == 0)
+		{
+			slot = i;
+			break;
+		}
+	}
+	if (slot == -1)
+		return(-1);
+
+	/*
+	 * A fitting block starts at the beginning of the area or at the end of
+	 * another block.
+	 */
+	for (i = -1; i < SHARED_MAX_BLOCKS; ++i)
+	{
+		Size candidate;
+
+		if (i == -1)
+			candidate = 0;
+		else if (blocks[i].sb_size == 0)
+			continue;
+		else
+			candidate = blocks[i].sb_offset + blocks[i].sb_size;
+
+		if (size > shared_header->sh_size - candidate
+			|| (found && candidate >= offset))
+			continue;
+
+		for (j = 0; j < SHARED_MAX_BLOCKS; ++j)
+		{
+			if (blocks[j].sb_size != 0
+				&& blocks[j].sb_offset < candidate + size
+				&& candidate < blocks[j].sb_offset + blocks[j].sb_size)
+				break;
+		}
+		if (j == SHARED_MAX_BLOCKS)
+		{
+			offset = candidate;
+			found = true;
+		}
+	}
+	if (!found)
+		return(-1);
+
+	blocks[slot].sb_offset = offset;
+	blocks[slot].sb_size = size;
+	blocks[slot].sb_pins = 0;
+	blocks[slot].sb_current = true;
+	shared_header->sh_used += size;
+
+	return(slot);
+}
+
+/*
+ * Free the block if it is no longer the current version of an entry, and no
+ * views of it remain.
+ *
+ * Expects the caller to hold the lock exclusively.
+ */
+static void
+shared_reclaim(int block)
+{
+	struct shared_block *b = &(shared_header->sh_blocks[block]);
+
+	if (b->sb_current || b->sb_pins > 0)
+		return;
+
+	shared_header->sh_used -= b->sb_size;
+	b->sb_size = 0;
+}
+
+/*
+ * Release the pins that remain when the backend exits.
+ */
+static void
+shared_exit(int code, Datum arg)
+{
+	int i;
+
+	shared_exited = true;
+
+	LWLockAcquire(shared_header->sh_lock, LW_EXCLUSIVE);
+	for (i = 0; i < SHARED_MAX_BLOCKS; ++i)
+	{
+		if (shared_pins[i] == 0)
+			continue;
+
+		shared_header->sh_blocks[i].sb_pins -= shared_pins[i];
+		shared_pins[i] = 0;
+		shared_reclaim(i);
+	}
+	LWLockRelease(shared_header->sh_lock);
+}
+
+/*
+ * Postgres.SharedVersion; exports the data of a version, and holds a pin on
+ * its block until it is released.
+ */
+struct PyPgSharedVersion {
+	PyObject_HEAD
+	int sv_block;				/* -1 when nothing is pinned */
+	char *sv_data;
+	Py_ssize_t sv_size;
+};
+#define SV(SELF) ((struct PyPgSharedVersion *) (SELF))
+
+static int
+shared_version_getbuffer(PyObj self, Py_buffer *view, int flags)
+{
+	return(PyBuffer_FillInfo(view, self, SV(self)->sv_data,
+		SV(self)->sv_size, 1, flags));
+}
+
+static PyBufferProcs PyPgSharedVersion_Buffer = {
+	shared_version_getbuffer,
+	NULL,
+};
+
+static void
+shared_version_dealloc(PyObj self)
+{
+	int block = SV(self)->sv_block;
+	MemoryContext former = CurrentMemoryContext;
+
+	/*
+	 * After shared_exit, the pins have been released already.
+	 */
+	if (block != -1 && !shared_exited)
+	{
+		PG_TRY();
+		{
+			LWLockAcquire(shared_header->sh_lock, LW_EXCLUSIVE);
+			--(shared_header->sh_blocks[block].sb_pins);
+			--(shared_pins[block]);
+			shared_reclaim(block);
+			LWLockRelease(shared_header->sh_lock);
+		}
+		PG_CATCH();
+		{
+			/*
+			 * Deallocation cannot fail; shared_exit releases the pin.
+			 */
+			MemoryContextSwitchTo(former);
+			FlushErrorState();
+		}
+		PG_END_TRY();
+	}
+
+	Py_TYPE(self)->tp_free(self);
+}
+
+static const char PyPgSharedVersion_Doc[] =
+	"A version of a shared buffer that is kept while it is viewed";
+
+PyTypeObject PyPgSharedVersion_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"Postgres.SharedVersion",			/* tp_name */
+	sizeof(struct PyPgSharedVersion),	/* tp_basicsize */
+	0,									/* tp_itemsize */
+	shared_version_dealloc,				/* tp_dealloc */
+	NULL,								/* tp_print */
+	NULL,								/* tp_getattr */
+	NULL,								/* tp_setattr */
+	NULL,								/* tp_compare */
+	NULL,								/* tp_repr */
+	NULL,								/* tp_as_number */
+	NULL,								/* tp_as_sequence */
+	NULL,								/* tp_as_mapping */
+	NULL,								/* tp_hash */
+	NULL,								/* tp_call */
+	NULL,								/* tp_str */
+	NULL,								/* tp_getattro */
+	NULL,								/* tp_setattro */
+	&PyPgSharedVersion_Buffer,			/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT,					/* tp_flags */
+	PyPgSharedVersion_Doc,				/* tp_doc */
+	NULL,								/* tp_traverse */
+	NULL,								/* tp_clear */
+	NULL,								/* tp_richcompare */
+	0,									/* tp_weaklistoffset */
+	NULL,								/* tp_iter */
+	NULL,								/* tp_iternext */
+	NULL,								/* tp_methods */
+	NULL,								/* tp_members */
+	NULL,								/* tp_getset */
+	NULL,								/* tp_base */
+	NULL,								/* tp_dict */
+	NULL,								/* tp_descr_get */
+	NULL,								/* tp_descr_set */
+	0,									/* tp_dictoffset */
+	NULL,								/* tp_init */
+	NULL,								/* tp_alloc */
+	NULL,								/* tp_new */
+};
+
+PyObj
+shared_get(PyObj name)
+{
+	char key[NAMEDATALEN];
+	struct shared_entry entry;
+	volatile bool found = false;
+	PyObj version, rob;
+
+	if (shared_key(name, key) == -1)
+		return(NULL);
+
+	/*
+	 * Nothing is published when the region does not exist.
+	 */
+	if (shared_header == NULL)
+	{
+		PyErr_SetObject(PyExc_KeyError, name);
+		return(NULL);
+	}
+
+	/*
+	 * Allocated first, so that a pin is never taken without an object to
+	 * release it.
+	 */
+	version = PyPgSharedVersion_Type.tp_alloc(&PyPgSharedVersion_Type, 0);
+	if (version == NULL)
+		return(NULL);
+	SV(version)->sv_block = -1;
+
+	PG_TRY();
+	{
+		struct shared_entry *e;
+
+		if (!shared_exit_registered)
+		{
+			on_shmem_exit(shared_exit, (Datum) 0);
+			shared_exit_registered = true;
+		}
+
+		LWLockAcquire(shared_header->sh_lock, LW_EXCLUSIVE);
+		e = shared_find(key);
+		if (e != NULL && e->se_block != -1)
+		{
+			entry = *e;
+			++(shared_header->sh_blocks[entry.se_block].sb_pins);
+			++(shared_pins[entry.se_block]);
+			SV(version)->sv_block = entry.se_block;
+			found = true;
+		}
+		LWLockRelease(shared_header->sh_lock);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred() || !found)
+	{
+		Py_DECREF(version);
+		if (!PyErr_Occurred())
+			PyErr_SetObject(PyExc_KeyError, name);
+		return(NULL);
+	}
+
+	/*
+	 * The data of a version is never modified while it is pinned, so the
+	 * view does not need the lock.
+	 */
+	SV(version)->sv_data = SHARED_DATA(shared_header)
+		+ shared_header->sh_blocks[entry.se_block].sb_offset;
+	SV(version)->sv_size = (Py_ssize_t) entry.se_size;
+
+	rob = PyMemoryView_FromObject(version);
+	Py_DECREF(version);
+
+	return(rob);
+}
+
+PyObj
+shared_publish(PyObj name, PyObj data)
+{
+	char key[NAMEDATALEN];
+	Py_buffer buf;
+	volatile uint32 version = 0;
+
+	if (shared_available() == -1 || shared_key(name, key) == -1)
+		return(NULL);
+
+	if (PyObject_GetBuffer(data, &buf, PyBUF_SIMPLE) == -1)
+		return(NULL);
+
+	PG_TRY();
+	{
+		struct shared_entry *e;
+		Size size = (Size) buf.len;
+		Size aligned = Max(MAXALIGN(size), MAXIMUM_ALIGNOF);
+		int block, previous;
+
+		if (!superuser())
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				errmsg("must be superuser to publish shared buffers")
+			));
+		}
+
+		/*
+		 * Reserve the entry and the block under one hold of the lock, and
+		 * copy the data without it. The entry is not visible until it has a
+		 * block.
+		 */
+		LWLockAcquire(shared_header->sh_lock, LW_EXCLUSIVE);
+		e = shared_find(key);
+		if (e == NULL && shared_header->sh_nentries >= SHARED_MAX_ENTRIES)
+		{
+			LWLockRelease(shared_header->sh_lock);
+			ereport(ERROR,(
+				errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				errmsg("cannot publish more than %d shared buffers",
+					SHARED_MAX_ENTRIES)
+			));
+		}
+
+		block = shared_allocate(aligned);
+		if (block == -1)
+		{
+			Size available = shared_header->sh_size - shared_header->sh_used;
+
+			LWLockRelease(shared_header->sh_lock);
+			ereport(ERROR,(
+				errcode(ERRCODE_OUT_OF_MEMORY),
+				errmsg("out of shared memory for shared buffer \"%s\"", key),
+				errdetail("%lu bytes were requested, %lu bytes are not in use by current or viewed versions.",
+					(unsigned long) size, (unsigned long) available),
+				errhint("Increase python.shared_memory, or release the views of replaced versions.")
+			));
+		}
+
+		if (e == NULL)
+		{
+			e = &(shared_header->sh_entries[shared_header->sh_nentries]);
+			strcpy(e->se_name, key);
+			e->se_block = -1;
+			++(shared_header->sh_nentries);
+		}
+		LWLockRelease(shared_header->sh_lock);
+
+		memcpy(SHARED_DATA(shared_header) + shared_header->sh_blocks[block].sb_offset,
+			buf.buf, size);
+
+		/*
+		 * Entries are never removed, so e remains the name's entry.
+		 */
+		LWLockAcquire(shared_header->sh_lock, LW_EXCLUSIVE);
+		previous = e->se_block;
+		e->se_block = block;
+		e->se_size = size;
+		e->se_version = ++(shared_header->sh_version);
+		version = e->se_version;
+		if (previous != -1)
+		{
+			shared_header->sh_blocks[previous].sb_current = false;
+			shared_reclaim(previous);
+		}
+		LWLockRelease(shared_header->sh_lock);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(true);
+	}
+	PG_END_TRY();
+
+	PyBuffer_Release(&buf);
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	return(PyLong_FromUnsignedLong(version));
+}
+
+PyObj
+shared_entries(void)
+{
+	struct shared_entry entries[SHARED_MAX_ENTRIES];
+	volatile int n = 0;
+	int i;
+	PyObj rob;
+
+	if (shared_header != NULL)
+	{
+		PG_TRY();
+		{
+			LWLockAcquire(shared_header->sh_lock, LW_SHARED);
+			n = shared_header->sh_nentries;
+			memcpy(entries, shared_header->sh_entries,
+				sizeof(struct shared_entry) * n);
+			LWLockRelease(shared_header->sh_lock);
+		}
+		PG_CATCH();
+		{
+			PyErr_SetPgError(false);
+		}
+		PG_END_TRY();
+
+		if (PyErr_Occurred())
+			return(NULL);
+	}
+
+	rob = PyDict_New();
+	if (rob == NULL)
+		return(NULL);
+
+	for (i = 0; i < n; ++i)
+	{
+		PyObj v;
+		int r;
+
+		/*
+		 * Reserved by a publication that has not finished copying.
+		 */
+		if (entries[i].se_block == -1)
+			continue;
+
+		v = Py_BuildValue("(kn)", (unsigned long) entries[i].se_version,
+			(Py_ssize_t) entries[i].se_size);
+		if (v == NULL)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+
+		r = PyDict_SetItemString(rob, entries[i].se_name, v);
+		Py_DECREF(v);
+		if (r == -1)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+	}
+
+	return(rob);
+}
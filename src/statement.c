@@ -26,7 +26,9 @@
 #include "pypg/extension.h"
 #include "pypg/pl.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
 #include "pypg/function.h"
+#include "pypg/stats.h"
 
 #include "pypg/tupledesc.h"
 #include "pypg/type/type.h"
@@ -251,6 +253,24 @@ statement_rows(PyObj self, PyObj args, PyObj kw)
 	return(PyPgCursor_New(self, args, kw, CUR_ROWS(50)));
 }
 
+static PyObj
+statement_rows_with_hold(PyObj self, PyObj args, PyObj kw)
+{
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	if (!PyPgStatement_ReturnsRows(self))
+	{
+		PyErr_SetString(PyExc_TypeError, "statement does not return rows");
+		return(NULL);
+	}
+
+	if (resolve_parameters(self, &args, &kw))
+		return(NULL);
+
+	return(PyPgCursor_NewHeld(self, args, kw, CUR_ROWS(50)));
+}
+
 static PyObj
 statement_column(PyObj self, PyObj args, PyObj kw)
 {
@@ -356,6 +376,7 @@ statement_first(PyObj self, PyObj args, PyObj kw)
 			bool *nulls;
 			char *cnulls;
 			int *freemap = PyPgTupleDesc_GetFreeMap(tdo);
+			instr_time spi_start;
 
 			datums = palloc(sizeof(Datum) * td->natts);
 			nulls = palloc(sizeof(bool) * td->natts);
@@ -370,7 +391,10 @@ statement_first(PyObj self, PyObj args, PyObj kw)
 			{
 				cnulls[r] = nulls[r] ? 'n' : ' ';
 			}
+			PL_STATS_SPI_CALL();
+			PL_STATS_START(spi_start);
 			r = SPI_execute_plan(plan, datums, cnulls, PL_FN_READONLY(), 1);
+			PL_STATS_SPI_ACCUM(spi_start);
 			if (r < 0)
 				raise_spi_error(r);
 			rob = PyLong_FromUnsignedLong(SPI_processed);
@@ -429,6 +453,24 @@ statement_declare(PyObj self, PyObj args, PyObj kw)
 	return(PyPgCursor_New(self, args, kw, CUR_SCROLL_FORWARD));
 }
 
+static PyObj
+statement_declare_with_hold(PyObj self, PyObj args, PyObj kw)
+{
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	if (!PyPgStatement_ReturnsRows(self))
+	{
+		PyErr_SetString(PyExc_TypeError, "statement does not return rows");
+		return(NULL);
+	}
+
+	if (resolve_parameters(self, &args, &kw))
+		return(NULL);
+
+	return(PyPgCursor_NewHeld(self, args, kw, CUR_SCROLL_FORWARD));
+}
+
 static int
 load_rows(PyObj self, PyObj row_iter, uint32 *total)
 {
@@ -456,6 +498,7 @@ load_rows(PyObj self, PyObj row_iter, uint32 *total)
 		int rnatts = PyPgTupleDesc_GetNatts(tdo);
 		int *freemap = PyPgTupleDesc_GetFreeMap(tdo);
 		int spi_r;
+		instr_time spi_start;
 
 		datums = palloc(sizeof(Datum) * td->natts);
 		nulls = palloc(sizeof(bool) * td->natts);
@@ -483,7 +526,10 @@ load_rows(PyObj self, PyObj row_iter, uint32 *total)
 			{
 				cnulls[spi_r] = nulls[spi_r] ? 'n' : ' ';
 			}
+			PL_STATS_SPI_CALL();
+			PL_STATS_START(spi_start);
 			spi_r = SPI_execute_plan(plan, datums, cnulls, false, 1);
+			PL_STATS_SPI_ACCUM(spi_start);
 
 			/*
 			 * Free the built datums.
@@ -613,6 +659,10 @@ static PyMethodDef PyPgStatement_Methods[] = {
 		PyDoc_STR("return an iterable to the chunks of rows produced by the statement")},
 	{"declare", (PyCFunction) statement_declare, METH_VARARGS|METH_KEYWORDS,
 		PyDoc_STR("declare a scrollable cursor using the given parameters")},
+	{"rows_with_hold", (PyCFunction) statement_rows_with_hold, METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("return an iterable to the rows produced by the statement that remains usable after the transaction commits")},
+	{"declare_with_hold", (PyCFunction) statement_declare_with_hold, METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("declare a scrollable cursor that remains usable after the transaction commits")},
 	{"load_rows", (PyCFunction) statement_load_rows, METH_VARARGS|METH_KEYWORDS,
 		PyDoc_STR("load the sequence of parameters using the statement")},
 	{"load_chunks", (PyCFunction) statement_load_chunks, METH_VARARGS|METH_KEYWORDS,
@@ -624,7 +674,7 @@ static void
 statement_dealloc(PyObj self)
 {
 	PyPgStatement ps;
-	SPIPlanPtr plan, splan;
+	SPIPlanPtr plan, splan, hplan, shplan;
 	MemoryContext memory;
 	PyObj ob;
 
@@ -647,8 +697,12 @@ statement_dealloc(PyObj self)
 	ps = (PyPgStatement) self;
 	plan = ps->ps_plan;
 	splan = ps->ps_scroll_plan;
+	hplan = ps->ps_hold_plan;
+	shplan = ps->ps_scroll_hold_plan;
 	ps->ps_plan = NULL;
 	ps->ps_scroll_plan = NULL;
+	ps->ps_hold_plan = NULL;
+	ps->ps_scroll_hold_plan = NULL;
 	memory = PyPgStatement_GetMemory(self);
 
 	/*
@@ -657,7 +711,8 @@ statement_dealloc(PyObj self)
 	PyPgStatement_SetParameterTypes(self, NULL);
 	PyPgStatement_SetPath(self, NULL);
 
-	if (plan != NULL || splan != NULL || memory != NULL)
+	if (plan != NULL || splan != NULL || hplan != NULL || shplan != NULL
+		|| memory != NULL)
 	{
 		MemoryContext former = CurrentMemoryContext;
 
@@ -669,6 +724,10 @@ statement_dealloc(PyObj self)
 				SPI_freeplan(plan);
 			if (splan)
 				SPI_freeplan(splan);
+			if (hplan)
+				SPI_freeplan(hplan);
+			if (shplan)
+				SPI_freeplan(shplan);
 
 			/*
 			 * When PLPY_STRANGE_THINGS is defined.
@@ -992,6 +1051,8 @@ PyPgStatement_NEW(PyTypeObject *subtype, PyObj source, PyObj parameters)
 
 	((PyPgStatement) rob)->ps_plan = NULL;
 	((PyPgStatement) rob)->ps_scroll_plan = NULL;
+	((PyPgStatement) rob)->ps_hold_plan = NULL;
+	((PyPgStatement) rob)->ps_scroll_hold_plan = NULL;
 
 	MemoryContextSwitchTo(PythonWorkMemoryContext);
 	PG_TRY();
@@ -1086,17 +1147,17 @@ PyPgStatement_NEW(PyTypeObject *subtype, PyObj source, PyObj parameters)
 }
 
 /*
- * Build a plan.
+ * Build a plan with the given CURSOR_OPT_* options.
  */
 static SPIPlanPtr
-make_plan(PyObj self, bool with_scroll)
+make_plan(PyObj self, int cursor_options)
 {
 	volatile SPIPlanPtr splan = NULL;
 	PyObj source_str = PyPgStatement_GetString(self);
 
 	Assert(!ext_state);
 	/* it should return rows if we are SCROLLing... */
-	Assert(!with_scroll || (with_scroll && PyPgStatement_ReturnsRows(self)));
+	Assert(!(cursor_options & CURSOR_OPT_SCROLL) || PyPgStatement_ReturnsRows(self));
 
 	Py_INCREF(source_str);
 	PyObject_StrBytes(&source_str);
@@ -1120,7 +1181,7 @@ make_plan(PyObj self, bool with_scroll)
 				PyBytes_AS_STRING(source_str),
 				PyPgTupleDesc_GetNatts(PyPgStatement_GetInput(self)),
 				PyPgStatement_GetParameterTypes(self),
-				with_scroll ? CURSOR_OPT_SCROLL : 0
+				cursor_options
 			);
 		}
 		PG_CATCH();
@@ -1188,7 +1249,7 @@ PyPgStatement_GetPlan(PyObj self)
 
 	if (plan == NULL)
 	{
-		plan = s->ps_plan = make_plan(self, false);
+		plan = s->ps_plan = make_plan(self, 0);
 	}
 
 	return(plan);
@@ -1204,17 +1265,67 @@ PyPgStatement_GetScrollPlan(PyObj self)
 
 	if (plan == NULL)
 	{
-		plan = s->ps_scroll_plan = make_plan(self, true);
+		plan = s->ps_scroll_plan = make_plan(self, CURSOR_OPT_SCROLL);
+	}
+
+	return(plan);
+}
+
+/*
+ * Plans for cursors that outlive the transaction that opened them.
+ */
+SPIPlanPtr
+PyPgStatement_GetHoldPlan(PyObj self, bool with_scroll)
+{
+	PyPgStatement s = (PyPgStatement) self;
+	SPIPlanPtr plan;
+
+	if (with_scroll)
+	{
+		plan = s->ps_scroll_hold_plan;
+
+		if (plan == NULL)
+		{
+			plan = s->ps_scroll_hold_plan =
+				make_plan(self, CURSOR_OPT_SCROLL | CURSOR_OPT_HOLD);
+		}
+	}
+	else
+	{
+		plan = s->ps_hold_plan;
+
+		if (plan == NULL)
+			plan = s->ps_hold_plan = make_plan(self, CURSOR_OPT_HOLD);
 	}
 
 	return(plan);
 }
 
+/*
+ * preparable_parsetree - whether the raw parse tree is a query that can be
+ * prepared and executed as a Postgres.Statement
+ */
+static bool
+preparable_parsetree(Node *parsetree)
+{
+	if (IsA(parsetree, SelectStmt))
+		return(((SelectStmt *) parsetree)->intoClause == NULL);
+
+	return(IsA(parsetree, InsertStmt) ||
+		IsA(parsetree, UpdateStmt) ||
+		IsA(parsetree, DeleteStmt));
+}
+
 /*
  * execute_statements - execute multiple statements in the string
+ *
+ * If single_query is not NULL, it is set to whether the string consisted of
+ * exactly one SELECT, INSERT, UPDATE, or DELETE statement. Such a string is
+ * not executed here: the caller prepares it as a Postgres.Statement and
+ * executes the plan so that it is not analyzed and planned twice.
  */
 int
-execute_statements(const char *src)
+execute_statements(const char *src, bool *single_query)
 {
 	int n = 0;
 	List *raw_parsetree_list;
@@ -1231,6 +1342,19 @@ execute_statements(const char *src)
 	 * Parse the request string into a list of raw parse trees.
 	 */
 	raw_parsetree_list = pg_parse_query(src);
+
+	if (single_query != NULL)
+	{
+		*single_query = list_length(raw_parsetree_list) == 1 &&
+			preparable_parsetree((Node *) linitial(raw_parsetree_list));
+
+		if (*single_query)
+		{
+			error_context_stack = errccb.previous;
+			return(1);
+		}
+	}
+
 	dest = CreateDestReceiver(DestNone);
 
 	/*
@@ -1320,5 +1444,66 @@ execute_statements(const char *src)
 	}
 
 	error_context_stack = errccb.previous;
+
 	return n;
 }
+
+/*
+ * execute_plan - execute the statement's plan to completion
+ *
+ * Used by Postgres.execute to run the statements that it has prepared.
+ * The statement must not take parameters.
+ */
+int
+execute_plan(PyObj self)
+{
+	SPIPlanPtr plan;
+
+	plan = PyPgStatement_GetPlan(self);
+	if (plan == NULL)
+		return(-1);
+
+	PG_TRY();
+	{
+		instr_time spi_start;
+
+		PL_STATS_SPI_CALL();
+		PL_STATS_START(spi_start);
+		if (SPI_is_cursor_plan(plan))
+		{
+			Portal p;
+
+			/*
+			 * The rows are discarded, as they are by execute_statements.
+			 * Fetch them in batches rather than having SPI_execute_plan
+			 * materialize all of them.
+			 */
+			p = SPI_cursor_open(NULL, plan, NULL, NULL, false);
+			do
+			{
+				SPI_cursor_fetch(p, true, 100);
+				SPI_freetuptable(SPI_tuptable);
+			}
+			while (SPI_processed == 100);
+			SPI_cursor_close(p);
+		}
+		else
+		{
+			int r;
+
+			r = SPI_execute_plan(plan, NULL, NULL, false, 0);
+			if (r < 0)
+				raise_spi_error(r);
+			SPI_freetuptable(SPI_tuptable);
+		}
+		PL_STATS_SPI_ACCUM(spi_start);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+		return(-1);
+	}
+	PG_END_TRY();
+
+	return(0);
+}
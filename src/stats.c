@@ -0,0 +1,281 @@
+/*
+ * Handler instrumentation
+ *
+ * Counters and timers maintained by the handler, Statements, Cursors,
+ * and the type cache. Exposed via Postgres.stats().
+ */
+#include <setjmp.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/pl.h"
+#include "pypg/stats.h"
+
+struct pl_stats pl_stats;
+bool pl_track_functions = false;
+
+/*
+ * Oid -> struct pl_fn_stats
+ */
+static HTAB *fn_stats_table = NULL;
+
+static void
+fn_stats_clear(struct pl_fn_stats *fs)
+{
+	fs->fs_calls = 0;
+	fs->fs_errors = 0;
+	fs->fs_loads = 0;
+	fs->fs_spi_calls = 0;
+	INSTR_TIME_SET_ZERO(fs->fs_spi);
+	INSTR_TIME_SET_ZERO(fs->fs_total);
+	INSTR_TIME_SET_ZERO(fs->fs_initialize);
+	INSTR_TIME_SET_ZERO(fs->fs_arguments);
+	INSTR_TIME_SET_ZERO(fs->fs_main);
+	INSTR_TIME_SET_ZERO(fs->fs_result);
+}
+
+void
+pl_stats_init(void)
+{
+	static bool defined = false;
+
+	if (defined)
+		return;
+
+#if PG_VERSION_NUM >= 90100
+	DefineCustomBoolVariable("python.track_functions",
+		"Collect the timing statistics of Python functions.",
+		"The times spent in each part of the handler are reported by "
+		"Postgres.stats(). The call counts are always collected.",
+		&pl_track_functions, false,
+		PGC_SUSET, 0, NULL, NULL, NULL);
+#else
+	DefineCustomBoolVariable("python.track_functions",
+		"Collect the timing statistics of Python functions.",
+		"The times spent in each part of the handler are reported by "
+		"Postgres.stats(). The call counts are always collected.",
+		&pl_track_functions, false,
+		PGC_SUSET, 0, NULL, NULL);
+#endif
+
+	defined = true;
+}
+
+/*
+ * pl_stats_function - get the stats entry for the function, creating it if
+ * necessary
+ *
+ * ON ERROR: Postgres elog
+ */
+struct pl_fn_stats *
+pl_stats_function(Oid fn_oid)
+{
+	struct pl_fn_stats *fs;
+	bool found;
+
+	if (fn_stats_table == NULL)
+	{
+		HASHCTL ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(struct pl_fn_stats);
+		ctl.hash = oid_hash;
+		fn_stats_table = hash_create("Python function statistics", 64,
+			&ctl, HASH_ELEM | HASH_FUNCTION);
+	}
+
+	fs = (struct pl_fn_stats *) hash_search(fn_stats_table,
+		(void *) &fn_oid, HASH_ENTER, &found);
+	if (!found)
+		fn_stats_clear(fs);
+
+	return(fs);
+}
+
+/*
+ * pl_stats_reset - zero all the counters
+ */
+void
+pl_stats_reset(void)
+{
+	pl_stats.st_spi_calls = 0;
+	INSTR_TIME_SET_ZERO(pl_stats.st_spi);
+	pl_stats.st_type_cache_hits = 0;
+	pl_stats.st_type_cache_misses = 0;
+	pl_stats.st_xact_collections = 0;
+	INSTR_TIME_SET_ZERO(pl_stats.st_xact_collect);
+	pl_stats.st_code_cache_hits = 0;
+	pl_stats.st_code_cache_misses = 0;
+	pl_stats.st_resets = 0;
+	pl_stats.st_subxacts = 0;
+	pl_stats.st_subxacts_avoided = 0;
+	pl_stats.st_subxid_overflows = 0;
+	pl_stats.st_toast_deferred = 0;
+	pl_stats.st_toast_detoasted = 0;
+
+	if (fn_stats_table != NULL)
+	{
+		HASH_SEQ_STATUS status;
+		struct pl_fn_stats *fs;
+
+		hash_seq_init(&status, fn_stats_table);
+		while ((fs = (struct pl_fn_stats *) hash_seq_search(&status)) != NULL)
+			fn_stats_clear(fs);
+	}
+}
+
+static int
+set_count(PyObj d, const char *key, uint64 n)
+{
+	PyObj ob;
+	int r;
+
+	ob = PyLong_FromUnsignedLongLong((unsigned PY_LONG_LONG) n);
+	if (ob == NULL)
+		return(-1);
+	r = PyDict_SetItemString(d, key, ob);
+	Py_DECREF(ob);
+
+	return(r);
+}
+
+static int
+set_time(PyObj d, const char *key, instr_time t)
+{
+	PyObj ob;
+	int r;
+
+	ob = PyFloat_FromDouble(INSTR_TIME_GET_DOUBLE(t));
+	if (ob == NULL)
+		return(-1);
+	r = PyDict_SetItemString(d, key, ob);
+	Py_DECREF(ob);
+
+	return(r);
+}
+
+static PyObj
+fn_stats_dict(struct pl_fn_stats *fs)
+{
+	PyObj rob;
+
+	rob = PyDict_New();
+	if (rob == NULL)
+		return(NULL);
+
+	if (set_count(rob, "calls", fs->fs_calls)
+		|| set_count(rob, "errors", fs->fs_errors)
+		|| set_count(rob, "loads", fs->fs_loads)
+		|| set_count(rob, "spi_calls", fs->fs_spi_calls)
+		|| set_time(rob, "spi", fs->fs_spi)
+		|| set_time(rob, "total", fs->fs_total)
+		|| set_time(rob, "initialize", fs->fs_initialize)
+		|| set_time(rob, "arguments", fs->fs_arguments)
+		|| set_time(rob, "main", fs->fs_main)
+		|| set_time(rob, "result", fs->fs_result))
+	{
+		Py_DECREF(rob);
+		return(NULL);
+	}
+
+	return(rob);
+}
+
+/*
+ * pl_stats_get - build the dictionary returned by Postgres.stats()
+ *
+ * ON ERROR: Returns NULL and sets a Python exception.
+ */
+PyObj
+pl_stats_get(void)
+{
+	PyObj rob, functions;
+
+	rob = PyDict_New();
+	if (rob == NULL)
+		return(NULL);
+
+	functions = PyDict_New();
+	if (functions == NULL)
+		goto fail;
+	if (PyDict_SetItemString(rob, "functions", functions))
+	{
+		Py_DECREF(functions);
+		goto fail;
+	}
+	Py_DECREF(functions); /* borrow from rob */
+
+	if (fn_stats_table != NULL)
+	{
+		HASH_SEQ_STATUS status;
+		struct pl_fn_stats *fs;
+
+		hash_seq_init(&status, fn_stats_table);
+		while ((fs = (struct pl_fn_stats *) hash_seq_search(&status)) != NULL)
+		{
+			PyObj oid_ob, d;
+			int r;
+
+			/*
+			 * Entries that were reset and not used since are skipped.
+			 */
+			if (fs->fs_calls == 0 && fs->fs_errors == 0)
+				continue;
+
+			d = fn_stats_dict(fs);
+			if (d == NULL)
+			{
+				hash_seq_term(&status);
+				goto fail;
+			}
+
+			oid_ob = PyLong_FromUnsignedLong(fs->fs_oid);
+			if (oid_ob == NULL)
+			{
+				Py_DECREF(d);
+				hash_seq_term(&status);
+				goto fail;
+			}
+
+			r = PyDict_SetItem(functions, oid_ob, d);
+			Py_DECREF(oid_ob);
+			Py_DECREF(d);
+			if (r)
+			{
+				hash_seq_term(&status);
+				goto fail;
+			}
+		}
+	}
+
+	if (set_count(rob, "spi_calls", pl_stats.st_spi_calls)
+		|| set_time(rob, "spi", pl_stats.st_spi)
+		|| set_count(rob, "type_cache_hits", pl_stats.st_type_cache_hits)
+		|| set_count(rob, "type_cache_misses", pl_stats.st_type_cache_misses)
+		|| set_count(rob, "xact_collections", pl_stats.st_xact_collections)
+		|| set_time(rob, "xact_collect", pl_stats.st_xact_collect)
+		|| set_count(rob, "code_cache_hits", pl_stats.st_code_cache_hits)
+		|| set_count(rob, "code_cache_misses", pl_stats.st_code_cache_misses)
+		|| set_count(rob, "resets", pl_stats.st_resets)
+		|| set_count(rob, "subxacts", pl_stats.st_subxacts)
+		|| set_count(rob, "subxacts_avoided", pl_stats.st_subxacts_avoided)
+		|| set_count(rob, "subxid_overflows", pl_stats.st_subxid_overflows)
+		|| set_count(rob, "toast_deferred", pl_stats.st_toast_deferred)
+		|| set_count(rob, "toast_detoasted", pl_stats.st_toast_detoasted))
+		goto fail;
+
+	return(rob);
+fail:
+	Py_DECREF(rob);
+	return(NULL);
+}
@@ -112,6 +112,116 @@ py_list_dimensions(PyObj seq, int *dims)
 	return(ndims);
 }
 
+/*
+ * element_datum_fast - convert a builtin Python object into a Datum of one of
+ * the common element types
+ *
+ * Returns false when the object must be given to PyPgType_DatumNew; this is
+ * the case for any object that is not exactly of the expected builtin type,
+ * and for values that would not convert cleanly, so that the generic path
+ * reports the error.
+ */
+static bool
+element_datum_fast(Oid typoid, PyObj ob, Datum *out)
+{
+	switch (typoid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case OIDOID:
+		{
+			long the_int;
+			int overflow;
+
+			if (!PyLong_CheckExact(ob))
+				return(false);
+
+			the_int = PyLong_AsLongAndOverflow(ob, &overflow);
+			if (overflow)
+				return(false);
+
+			if (typoid == INT2OID)
+			{
+				if (the_int < -0x8000 || the_int > 0x7FFF)
+					return(false);
+				*out = Int16GetDatum((int16) the_int);
+			}
+			else if (typoid == INT4OID)
+			{
+#if SIZEOF_LONG > 4
+				if (the_int < -INT64CONST(0x80000000) || the_int > INT64CONST(0x7FFFFFFF))
+					return(false);
+#endif
+				*out = Int32GetDatum((int32) the_int);
+			}
+			else
+			{
+				if (the_int < 0)
+					return(false);
+#if SIZEOF_LONG > 4
+				if (the_int > INT64CONST(0xFFFFFFFF))
+					return(false);
+#endif
+				*out = ObjectIdGetDatum((Oid) the_int);
+			}
+		}
+		break;
+
+		case INT8OID:
+		{
+			PY_LONG_LONG the_int;
+
+			if (!PyLong_CheckExact(ob))
+				return(false);
+
+			the_int = PyLong_AsLongLong(ob);
+			if (the_int == -1 && PyErr_Occurred())
+			{
+				PyErr_Clear();
+				return(false);
+			}
+
+			*out = Int64GetDatum((int64) the_int);
+		}
+		break;
+
+		case FLOAT4OID:
+			if (!PyFloat_CheckExact(ob))
+				return(false);
+			*out = Float4GetDatum((float) PyFloat_AS_DOUBLE(ob));
+		break;
+
+		case FLOAT8OID:
+			if (!PyFloat_CheckExact(ob))
+				return(false);
+			*out = Float8GetDatum(PyFloat_AS_DOUBLE(ob));
+		break;
+
+		case BOOLOID:
+			if (ob == Py_True)
+				*out = BoolGetDatum(true);
+			else if (ob == Py_False)
+				*out = BoolGetDatum(false);
+			else
+				return(false);
+		break;
+
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case NAMEOID:
+			if (!PyUnicode_CheckExact(ob))
+				return(false);
+			return(PyPgString_DatumFromPyUnicode(typoid, ob, out));
+		break;
+
+		default:
+			return(false);
+	}
+
+	return(true);
+}
+
 /*
  * fill_element - create all the Datums and NULLs using PyPgType_DatumNew
  *
@@ -129,9 +239,17 @@ fill_elements(
 	PyObj dstack[MAXDIM] = {listob, NULL,};
 	unsigned int i = 0; /* current, absolute element position */
 	int j, axis = 0; /* top */
+	Oid fast_typoid = InvalidOid;
 
 	Assert(PyList_GET_SIZE(listob) == dims[0]);
 
+	/*
+	 * Elements of the common types are converted directly when no
+	 * modifier needs to be applied.
+	 */
+	if (mod == -1)
+		fast_typoid = PyPgTypeInfo(element_type)->typoid;
+
 	/*
 	 * The filling of the Datum array ends when the total number of elements
 	 * have been processed. datums and nulls *must* be allocated to fit nelems.
@@ -191,8 +309,17 @@ fill_elements(
 		 */
 		for (j = 0; j < elements_per; ++j)
 		{
-			PyPgType_DatumNew(element_type, PyList_GET_ITEM(dstack[ndims-1], j),
-				mod, &(datums[i]), &(nulls[i]));
+			PyObj ob = PyList_GET_ITEM(dstack[ndims-1], j);
+
+			if (ob == Py_None)
+			{
+				datums[i] = 0;
+				nulls[i] = true;
+			}
+			else if (element_datum_fast(fast_typoid, ob, &(datums[i])))
+				nulls[i] = false;
+			else
+				PyPgType_DatumNew(element_type, ob, mod, &(datums[i]), &(nulls[i]));
 			++i;
 		}
 
@@ -535,6 +662,240 @@ py_array_length(PyObj self)
 		return(ARR_DIMS(at)[0]);
 }
 
+/*
+ * array_walk - navigate the data area of an ArrayType in physical order
+ *
+ * This is the equivalent of deconstruct_array, but one element at a time,
+ * so that callers can convert the elements directly without allocating
+ * Datum and null arrays or intermediate sub-arrays.
+ */
+typedef struct array_walk {
+	char *aw_ptr;		/* data of the next element */
+	bits8 *aw_bitmap;	/* NULL bitmap; NULL when the array has no NULLs */
+	int aw_offset;		/* absolute position of the next element */
+	int16 aw_typlen;
+	bool aw_typbyval;
+	char aw_typalign;
+} array_walk;
+
+static void
+array_walk_init(array_walk *aw, ArrayType *at, PyPgTypeInfo typinfo)
+{
+	aw->aw_ptr = ARR_DATA_PTR(at);
+	aw->aw_bitmap = ARR_NULLBITMAP(at);
+	aw->aw_offset = 0;
+	aw->aw_typlen = typinfo->typlen;
+	aw->aw_typbyval = typinfo->typbyval;
+	aw->aw_typalign = typinfo->typalign;
+}
+
+#define array_walk_isnull(AW) \
+	((AW)->aw_bitmap != NULL && \
+	!((AW)->aw_bitmap[(AW)->aw_offset / 8] & (1 << ((AW)->aw_offset % 8))))
+
+/*
+ * array_walk_next - fetch the next element
+ *
+ * Returns true if the element is NULL. The Datum points into the array.
+ */
+static bool
+array_walk_next(array_walk *aw, Datum *rdatum)
+{
+	if (array_walk_isnull(aw))
+	{
+		++(aw->aw_offset);
+		*rdatum = 0;
+		return(true);
+	}
+
+	*rdatum = fetch_att(aw->aw_ptr, aw->aw_typbyval, aw->aw_typlen);
+	aw->aw_ptr = att_addlength_pointer(aw->aw_ptr, aw->aw_typlen, aw->aw_ptr);
+	aw->aw_ptr = (char *) att_align_nominal(aw->aw_ptr, aw->aw_typalign);
+	++(aw->aw_offset);
+
+	return(false);
+}
+
+/*
+ * array_walk_skip - move past 'nitems' elements
+ *
+ * Returns the number of NULLs that were skipped.
+ */
+static int
+array_walk_skip(array_walk *aw, int nitems)
+{
+	int i, nnulls = 0;
+
+	if (aw->aw_bitmap == NULL && aw->aw_typlen > 0)
+	{
+		/*
+		 * Fixed length elements and no NULLs; it's a simple offset.
+		 */
+		aw->aw_ptr += nitems * att_align_nominal(aw->aw_typlen, aw->aw_typalign);
+		aw->aw_offset += nitems;
+		return(0);
+	}
+
+	for (i = 0; i < nitems; ++i)
+	{
+		Datum ignored;
+
+		if (array_walk_next(aw, &ignored))
+			++nnulls;
+	}
+
+	return(nnulls);
+}
+
+/*
+ * array_element_native - convert an element Datum into a builtin Python object
+ *
+ * Elements of the common scalar types are converted into the corresponding
+ * Python type. Others fall back to a Postgres.Object instance of the element
+ * type.
+ */
+static PyObj
+array_element_native(PyObj element_type, Datum d)
+{
+	Oid typoid = PyPgTypeInfo(element_type)->typoid;
+
+	switch (typoid)
+	{
+		case INT2OID:
+			return(PyLong_FromLong((long) DatumGetInt16(d)));
+		case INT4OID:
+			return(PyLong_FromLong((long) DatumGetInt32(d)));
+		case INT8OID:
+			return(PyLong_FromLongLong((PY_LONG_LONG) DatumGetInt64(d)));
+		case OIDOID:
+			return(PyLong_FromUnsignedLong((unsigned long) DatumGetObjectId(d)));
+		case FLOAT4OID:
+			return(PyFloat_FromDouble((double) DatumGetFloat4(d)));
+		case FLOAT8OID:
+			return(PyFloat_FromDouble(DatumGetFloat8(d)));
+		case BOOLOID:
+			return(PyBool_FromLong((long) DatumGetBool(d)));
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case NAMEOID:
+		{
+			PyObj rob = PyPgString_FromDatum(typoid, d);
+
+			if (rob != NULL || PyErr_Occurred())
+				return(rob);
+			return(PyPgObject_New(element_type, d));
+		}
+		default:
+			return(PyPgObject_New(element_type, d));
+	}
+}
+
+static PyObj
+array_walk_element(array_walk *aw, PyObj element_type, bool native)
+{
+	Datum d;
+
+	if (array_walk_next(aw, &d))
+	{
+		Py_INCREF(Py_None);
+		return(Py_None);
+	}
+
+	if (native)
+		return(array_element_native(element_type, d));
+	else
+		return(PyPgObject_New(element_type, d));
+}
+
+/*
+ * array_walk_list - build nested lists of the elements for the given dimensions
+ */
+static PyObj
+array_walk_list(array_walk *aw, PyObj element_type, bool native, int ndims, int *dims)
+{
+	PyObj rob;
+	int i;
+
+	rob = PyList_New(dims[0]);
+	if (rob == NULL)
+		return(NULL);
+
+	for (i = 0; i < dims[0]; ++i)
+	{
+		PyObj ob;
+
+		if (ndims > 1)
+			ob = array_walk_list(aw, element_type, native, ndims - 1, dims + 1);
+		else
+			ob = array_walk_element(aw, element_type, native);
+
+		if (ob == NULL)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+
+		PyList_SET_ITEM(rob, i, ob);
+	}
+
+	return(rob);
+}
+
+/*
+ * array_sub_array - build the sub-array at the given zero-based index of the
+ * first axis
+ *
+ * The data area of the sub-array is a contiguous region of the source, so
+ * it is copied directly into a single allocation.
+ */
+static ArrayType *
+array_sub_array(ArrayType *at, PyPgTypeInfo typinfo, int index)
+{
+	ArrayType *rat;
+	array_walk aw;
+	char *start;
+	int ndims = ARR_NDIM(at) - 1;
+	int nitems, nnulls, offset;
+	int32 dataoffset, nbytes;
+
+	Assert(ndims > 0);
+
+	nitems = ArrayGetNItems(ndims, ARR_DIMS(at) + 1);
+	array_walk_init(&aw, at, typinfo);
+
+	array_walk_skip(&aw, index * nitems);
+	start = aw.aw_ptr;
+	offset = aw.aw_offset;
+	nnulls = array_walk_skip(&aw, nitems);
+	nbytes = aw.aw_ptr - start;
+
+	if (nnulls > 0)
+	{
+		dataoffset = ARR_OVERHEAD_WITHNULLS(ndims, nitems);
+		nbytes += dataoffset;
+	}
+	else
+	{
+		dataoffset = 0;
+		nbytes += ARR_OVERHEAD_NONULLS(ndims);
+	}
+
+	rat = (ArrayType *) palloc0(nbytes);
+	SET_VARSIZE(rat, nbytes);
+	rat->ndim = ndims;
+	rat->dataoffset = dataoffset;
+	rat->elemtype = ARR_ELEMTYPE(at);
+	memcpy(ARR_DIMS(rat), ARR_DIMS(at) + 1, ndims * sizeof(int));
+	memcpy(ARR_LBOUND(rat), ARR_LBOUND(at) + 1, ndims * sizeof(int));
+	memcpy(ARR_DATA_PTR(rat), start, aw.aw_ptr - start);
+
+	if (nnulls > 0)
+		array_bitmap_copy(ARR_NULLBITMAP(rat), 0, ARR_NULLBITMAP(at), offset, nitems);
+
+	return(rat);
+}
+
 static PyObj
 array_item(PyObj self, Py_ssize_t item)
 {
@@ -563,7 +924,7 @@ array_item(PyObj self, Py_ssize_t item)
 	/*
 	 * Note that the comparison is '>', not '>='.
 	 */
-	if (index > ARR_DIMS(at)[0])
+	if (index > ARR_DIMS(at)[0] || index < 1)
 	{
 		PyErr_Format(PyExc_IndexError, "index %d out of range %d",
 			item, ARR_DIMS(at)[0]);
@@ -605,55 +966,13 @@ array_item(PyObj self, Py_ssize_t item)
 	else
 	{
 		ArrayType *rat;
-		int lower[MAXDIM] = {index,0,};
-		int upper[MAXDIM] = {index,0,};
 
 		/*
-		 * Multiple dimensions, so get a slice.
+		 * Multiple dimensions, so get the sub-array.
 		 */
 		PG_TRY();
 		{
-			ArrayType *xat;
-			Datum *elements;
-			bool *nulls;
-			int nelems;
-			int ndims, i;
-			int lbs[MAXDIM];
-			int dims[MAXDIM];
-
-			xat = array_get_slice(at, 1, upper, lower, atypinfo->typlen,
-						typinfo->typlen, typinfo->typbyval, typinfo->typalign);
-
-			/*
-			 * Eventually, this should probably be changed to change the already
-			 * allocated ArrayType at 'xat', but for now use the available
-			 * interfaces for creating the expected result.
-			 */
-			deconstruct_array(xat,
-				typinfo->typoid, typinfo->typlen, typinfo->typbyval, typinfo->typalign,
-				&elements, &nulls, &nelems
-			);
-
-			/*
-			 * Alter dims, lbs, and ndims: we are removing the first dimension.
-			 */
-			ndims = ARR_NDIM(xat);
-			for (i = 1; i < ndims; ++i)
-				lbs[i-1] = ARR_LBOUND(xat)[i];
-			for (i = 1; i < ndims; ++i)
-				dims[i-1] = ARR_DIMS(xat)[i];
-			--ndims;
-
-			/*
-			 * Construct the expected result to a Python itemget call.
-			 */
-			rat = construct_md_array(elements, nulls, ndims, dims, lbs,
-				typinfo->typoid, typinfo->typlen, typinfo->typbyval, typinfo->typalign);
-
-			pfree(elements);
-			pfree(nulls);
-			pfree(xat);
-
+			rat = array_sub_array(at, typinfo, (int) item);
 			rob = PyPgObject_New(Py_TYPE(self), PointerGetDatum(rat));
 			pfree(rat);
 		}
@@ -1176,6 +1495,173 @@ array_elements(PyObj self)
 	return(rob);
 }
 
+/*
+ * array_tolist - build nested lists of the array's elements
+ *
+ * The data area is walked once. When native is true, elements of the common
+ * scalar types are converted into builtin Python objects.
+ */
+static PyObj
+array_tolist(PyObj self, PyObj args, PyObj kw)
+{
+	static char *kwlist[] = {"native", NULL};
+	PyObj native_ob = Py_True;
+	PyObj element_type;
+	volatile PyObj rob = NULL;
+	int native;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|O:tolist", kwlist, &native_ob))
+		return(NULL);
+
+	native = PyObject_IsTrue(native_ob);
+	if (native == -1)
+		return(NULL);
+
+	element_type = PyPgType_GetElementType(Py_TYPE(self));
+
+	PG_TRY();
+	{
+		ArrayType *at;
+		array_walk aw;
+
+		at = DatumGetArrayTypeP(PyPgObject_GetDatum(self));
+
+		if (ARR_NDIM(at) == 0)
+			rob = PyList_New(0);
+		else
+		{
+			array_walk_init(&aw, at, PyPgTypeInfo(element_type));
+			rob = array_walk_list(&aw, element_type, native ? true : false,
+						ARR_NDIM(at), ARR_DIMS(at));
+		}
+	}
+	PG_CATCH();
+	{
+		Py_XDECREF(rob);
+		rob = NULL;
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	return(rob);
+}
+
+/*
+ * Iterator over the elements of an array in physical (row-major) order.
+ *
+ * Holds a reference to the array object, so the walk's pointers into the
+ * array's data area remain valid.
+ */
+struct PyPgArrayIter {
+	PyObject_HEAD
+	PyObj ai_array;
+	PyObj ai_element_type;
+	array_walk ai_walk;
+	int ai_nelems;
+	bool ai_native;
+};
+
+static void
+array_iter_dealloc(PyObj self)
+{
+	struct PyPgArrayIter *ai = (struct PyPgArrayIter *) self;
+
+	Py_XDECREF(ai->ai_array);
+	Py_XDECREF(ai->ai_element_type);
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyObj
+array_iter_next(PyObj self)
+{
+	struct PyPgArrayIter *ai = (struct PyPgArrayIter *) self;
+	volatile PyObj rob = NULL;
+
+	if (ai->ai_walk.aw_offset >= ai->ai_nelems)
+		return(NULL);
+
+	PG_TRY();
+	{
+		rob = array_walk_element(&(ai->ai_walk), ai->ai_element_type, ai->ai_native);
+	}
+	PG_CATCH();
+	{
+		Py_XDECREF(rob);
+		rob = NULL;
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	return(rob);
+}
+
+PyTypeObject PyPgArrayIter_Type = {
+	PyVarObject_HEAD_INIT(&PyType_Type, 0)
+	"Postgres.ArrayIter",							/* tp_name */
+	sizeof(struct PyPgArrayIter),					/* tp_basicsize */
+	0,												/* tp_itemsize */
+	array_iter_dealloc,								/* tp_dealloc */
+	NULL,											/* tp_print */
+	NULL,											/* tp_getattr */
+	NULL,											/* tp_setattr */
+	NULL,											/* tp_compare */
+	NULL,											/* tp_repr */
+	NULL,											/* tp_as_number */
+	NULL,											/* tp_as_sequence */
+	NULL,											/* tp_as_mapping */
+	NULL,											/* tp_hash */
+	NULL,											/* tp_call */
+	NULL,											/* tp_str */
+	NULL,											/* tp_getattro */
+	NULL,											/* tp_setattro */
+	NULL,											/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT,								/* tp_flags */
+	NULL,											/* tp_doc */
+	NULL,											/* tp_traverse */
+	NULL,											/* tp_clear */
+	NULL,											/* tp_richcompare */
+	0,												/* tp_weaklistoffset */
+	PyObject_SelfIter,								/* tp_iter */
+	array_iter_next,								/* tp_iternext */
+};
+
+/*
+ * array_iter_elements - iterate over the elements without deconstructing
+ * the array or building sub-arrays
+ */
+static PyObj
+array_iter_elements(PyObj self, PyObj args, PyObj kw)
+{
+	static char *kwlist[] = {"native", NULL};
+	PyObj native_ob = Py_True;
+	struct PyPgArrayIter *ai;
+	ArrayType *at;
+	int native;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|O:iter_elements", kwlist, &native_ob))
+		return(NULL);
+
+	native = PyObject_IsTrue(native_ob);
+	if (native == -1)
+		return(NULL);
+
+	ai = PyObject_New(struct PyPgArrayIter, &PyPgArrayIter_Type);
+	if (ai == NULL)
+		return(NULL);
+
+	Py_INCREF(self);
+	ai->ai_array = self;
+	ai->ai_element_type = PyPgType_GetElementType(Py_TYPE(self));
+	Py_INCREF(ai->ai_element_type);
+	ai->ai_native = native ? true : false;
+
+	at = DatumGetArrayTypeP(PyPgObject_GetDatum(self));
+	array_walk_init(&(ai->ai_walk), at, PyPgTypeInfo(ai->ai_element_type));
+	ai->ai_nelems = ArrayGetNItems(ARR_NDIM(at), ARR_DIMS(at));
+
+	return((PyObj) ai);
+}
+
 /*
  * array_from_elements - classmethod to build an array
  */
@@ -1334,6 +1820,10 @@ static PyMethodDef array_methods[] = {
 	PyDoc_STR("get a single element in the array using zero-based indexes")},
 	{"elements", (PyCFunction) array_elements, METH_NOARGS,
 	PyDoc_STR("get the ArrayElementsIter for the array")},
+	{"iter_elements", (PyCFunction) array_iter_elements, METH_VARARGS|METH_KEYWORDS,
+	PyDoc_STR("iterate over the elements of the array in physical order")},
+	{"tolist", (PyCFunction) array_tolist, METH_VARARGS|METH_KEYWORDS,
+	PyDoc_STR("build nested lists of the array's elements")},
 	{"from_elements", (PyCFunction) array_from_elements,
 		METH_VARARGS|METH_KEYWORDS|METH_CLASS,
 		PyDoc_STR("build an array from elements")},
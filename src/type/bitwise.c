@@ -14,6 +14,7 @@
 #include "access/htup.h"
 #include "access/tupdesc.h"
 #include "access/transam.h"
+#include "access/tuptoaster.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_namespace.h"
@@ -105,7 +106,11 @@ PyPgTypeObject PyPg_bool_Type = {{
 	PYPG_INIT_TYPINFO(bool)
 };
 
-#define get_bytea_length(DATUM) (VARSIZE(DATUM) - VARHDRSZ)
+/*
+ * Arguments may be toasted(PyPgObject_NewToasted), so the length is the
+ * raw size of the Datum.
+ */
+#define get_bytea_length(DATUM) (toast_raw_datum_size(DATUM) - VARHDRSZ)
 
 #ifdef NOT_USED
 /*
@@ -198,7 +203,7 @@ bytea_item(PyObj self, Py_ssize_t item)
 {
 	volatile PyObj rob = NULL;
 	Datum datum;
-	int32 len = 0;
+	Py_ssize_t len;
 
 	if (!PyPg_bytea_Check(self))
 	{
@@ -208,10 +213,11 @@ bytea_item(PyObj self, Py_ssize_t item)
 
 	datum = PyPgObject_GetDatum(self);
 
-	if (item >= get_bytea_length(datum))
+	len = get_bytea_length(datum);
+	if (item < 0 || item >= len)
 	{
 		PyErr_Format(PyExc_IndexError,
-			"index %d is out of range(%d)", item, len);
+			"index %zd is out of range(%zd)", item, len);
 		return(NULL);
 	}
 
@@ -300,6 +306,12 @@ bytea_getbuffer(PyObj self, Py_buffer *view, int flags)
 		return(-1);
 	}
 
+	/*
+	 * The whole buffer is needed.
+	 */
+	if (PyPgObject_Detoast(self) == -1)
+		return(-1);
+
 	d = PyPgObject_GetDatum(self);
 	data = VARDATA(d);
 	len = get_bytea_length(d);
@@ -319,20 +331,28 @@ bytea_subscript(PyObj self, PyObj sub)
 	char *data;
 	Py_ssize_t len;
 
-	if (PyObject_AsReadBuffer(self, (const void **) &data, &len))
+	if (!PyPg_bytea_Check(self))
+	{
+		PyErr_SetString(PyExc_TypeError, "requires a bytea instance");
 		return(NULL);
+	}
+
+	len = get_bytea_length(PyPgObject_GetDatum(self));
 
 	if (PySlice_Check(sub))
 	{
 		Py_ssize_t start, stop, step, slicelength;
 
-		if (!PyPg_bytea_Check(self))
-		{
-			PyErr_SetString(PyExc_TypeError, "requires a bytea instance");
+		if (PySlice_GetIndicesEx(sub, len, &start, &stop, &step, &slicelength))
 			return(NULL);
-		}
 
-		if (PySlice_GetIndicesEx(sub, len, &start, &stop, &step, &slicelength))
+		/*
+		 * Contiguous slices only fetch the necessary chunks of toasted data.
+		 */
+		if (step == 1)
+			return(bytea_slice(self, start, start + slicelength));
+
+		if (PyObject_AsReadBuffer(self, (const void **) &data, &len))
 			return(NULL);
 
 		PG_TRY();
@@ -11,6 +11,7 @@
 #include "access/heapam.h"
 #include "access/hash.h"
 #include "access/transam.h"
+#include "access/tuptoaster.h"
 #include "catalog/pg_cast.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_proc.h"
@@ -40,10 +41,13 @@
 #include "pypg/postgres.h"
 #include "pypg/extension.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
+#include "pypg/stats.h"
 #include "pypg/tupledesc.h"
 #include "pypg/type/type.h"
 #include "pypg/type/object.h"
 #include "pypg/type/bitwise.h"
+#include "pypg/type/string.h"
 #include "pypg/type/record.h"
 
 static PyMemberDef PyPgObject_Members[] = {
@@ -562,9 +566,13 @@ static long
 obj_hash(PyObj self)
 {
 	PyPgTypeInfo typinfo;
-	Datum ob_datum = PyPgObject_GetDatum(self);
+	Datum ob_datum;
 	long rv = 0;
 
+	if (PyPgObject_Detoast(self) == -1)
+		return(-1);
+	ob_datum = PyPgObject_GetDatum(self);
+
 	typinfo = PyPgTypeInfo(Py_TYPE(self));
 	if (typinfo->typbyval)
 	{
@@ -895,6 +903,102 @@ PyPgObject_Initialize(PyObj self, Datum d)
 	return(self);
 }
 
+/*
+ * PyPgObject_NewToasted - create an object without detoasting the Datum
+ *
+ * For bytea and text-like types, a compressed or external Datum is copied
+ * as-is; the toast pointer is only followed when the data is needed.
+ * Slices of bytea objects are fetched with PG_DETOAST_DATUM_SLICE, and the
+ * functions that text objects are operated with detoast the Datum
+ * themselves. Otherwise, this is PyPgObject_New.
+ *
+ * External Datums reference rows that are only guaranteed to be readable
+ * while the caller's snapshot is, so the caller is responsible for
+ * detoasting the objects that survive it. (See invoke_main in pl.c)
+ */
+PyObj
+PyPgObject_NewToasted(PyObj typ, Datum d)
+{
+	PyPgTypeInfo typinfo = PyPgTypeInfo(typ);
+	struct varlena *v = (struct varlena *) DatumGetPointer(d);
+	volatile PyObj rob = NULL;
+
+	if (typinfo->typlen != -1
+		|| !(VARATT_IS_EXTERNAL(v) || VARATT_IS_COMPRESSED(v))
+		|| !(PyObject_IsSubclass(typ, (PyObj) &PyPg_bytea_Type) > 0
+			|| PyObject_IsSubclass(typ, (PyObj) &PyPgString_Type) > 0))
+	{
+		PyErr_Clear();
+		return(PyPgObject_New(typ, d));
+	}
+
+	rob = PyPgObject_NEW(typ);
+	if (rob == NULL)
+		return(NULL);
+
+	PG_TRY();
+	{
+		Size size = VARSIZE_ANY(v);
+		char *copy;
+
+		copy = MemoryContextAlloc(PythonMemoryContext, size);
+		memcpy(copy, v, size);
+		PyPgObject_SetDatum(rob, PointerGetDatum(copy));
+	}
+	PG_CATCH();
+	{
+		Py_DECREF(rob);
+		rob = NULL;
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (rob != NULL)
+		++(pl_stats.st_toast_deferred);
+
+	return(rob);
+}
+
+/*
+ * PyPgObject_Detoast - replace the object's toasted Datum with its data
+ *
+ * Does nothing when the object is not toasted. Returns -1 with a Python
+ * exception set on failure.
+ */
+int
+PyPgObject_Detoast(PyObj self)
+{
+	Datum d;
+	volatile Datum rd = 0;
+	MemoryContext former = CurrentMemoryContext;
+
+	if (!PyPgObject_IsToasted(self))
+		return(0);
+
+	d = PyPgObject_GetDatum(self);
+
+	PG_TRY();
+	{
+		MemoryContextSwitchTo(PythonMemoryContext);
+		rd = PointerGetDatum(PG_DETOAST_DATUM_COPY(d));
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+	MemoryContextSwitchTo(former);
+
+	if (rd == 0)
+		return(-1);
+
+	PyPgObject_SetDatum(self, rd);
+	pfree(DatumGetPointer(d));
+	++(pl_stats.st_toast_detoasted);
+
+	return(0);
+}
+
 PyObj
 PyPgObject_FromTypeOidAndDatum(Oid typeoid, Datum d)
 {
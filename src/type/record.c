@@ -38,6 +38,7 @@
 #include "pypg/postgres.h"
 #include "pypg/extension.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
 #include "pypg/type/type.h"
 #include "pypg/type/object.h"
 #include "pypg/type/record.h"
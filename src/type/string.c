@@ -33,6 +33,7 @@
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 #include "utils/relcache.h"
+#include "mb/pg_wchar.h"
 
 #include "pypg/python.h"
 #include "pypg/postgres.h"
@@ -42,6 +43,168 @@
 #include "pypg/type/object.h"
 #include "pypg/type/string.h"
 
+/*
+ * decode_server_string - create a str from server encoded data
+ *
+ * UTF-8 is decoded directly instead of going through the codec lookup.
+ */
+static PyObj
+decode_server_string(const char *data, Py_ssize_t size)
+{
+	if (GetDatabaseEncoding() == PG_UTF8)
+		return(PyUnicode_DecodeUTF8(data, size, "replace"));
+
+	return(PyUnicode_FromPointerAndSize(data, size));
+}
+
+/*
+ * PyPgString_FromDatum - create a str from a text-like Datum
+ *
+ * The str is decoded from the Datum's data in place, so short varlenas are
+ * not copied. Types that are not text-like, and compressed or external
+ * values, are not handled; NULL is returned *without* an exception so that
+ * the caller can use typoutput instead.
+ */
+PyObj
+PyPgString_FromDatum(Oid typoid, Datum d)
+{
+	switch (typoid)
+	{
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+#ifdef JSONOID
+		case JSONOID:
+#endif
+		{
+			struct varlena *v = (struct varlena *) DatumGetPointer(d);
+
+			if (VARATT_IS_EXTERNAL(v) || VARATT_IS_COMPRESSED(v))
+				return(NULL);
+
+			return(decode_server_string(VARDATA_ANY(v), VARSIZE_ANY_EXHDR(v)));
+		}
+		break;
+
+		case NAMEOID:
+		{
+			const char *s = NameStr(*DatumGetName(d));
+
+			return(decode_server_string(s, strlen(s)));
+		}
+		break;
+	}
+
+	return(NULL);
+}
+
+/*
+ * PyPgString_DatumFromPyUnicode - build a text-like Datum from a str
+ *
+ * This skips the bytes object and typinput when the server encoding is UTF-8,
+ * and typinput otherwise; the varlena is built with a single allocation.
+ *
+ * Returns false *without* an exception when the conversion is not handled
+ * here: the type is not text-like(json needs validation), the string has a
+ * NUL(typinput would truncate it), or the string cannot be encoded. The
+ * caller is expected to use typinput, which will raise the appropriate error.
+ *
+ * Typmods are not applied, so varchar and bpchar callers must have a -1 typmod.
+ *
+ * ON ERROR: Postgres elog(palloc)
+ */
+bool
+PyPgString_DatumFromPyUnicode(Oid typoid, PyObj ob, Datum *out)
+{
+	const char *data;
+	Py_ssize_t size;
+	PyObj bytes = NULL;
+
+	switch (typoid)
+	{
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case NAMEOID:
+		break;
+
+		default:
+			return(false);
+	}
+
+#if PY_VERSION_HEX >= 0x03030000
+	if (GetDatabaseEncoding() == PG_UTF8)
+	{
+		/*
+		 * The UTF-8 representation is cached by the str object.
+		 */
+		data = PyUnicode_AsUTF8AndSize(ob, &size);
+		if (data == NULL)
+		{
+			PyErr_Clear();
+			return(false);
+		}
+	}
+	else
+#endif
+	{
+		bytes = PyUnicode_AsEncodedString(ob, python_server_encoding, "strict");
+		if (bytes == NULL)
+		{
+			PyErr_Clear();
+			return(false);
+		}
+		data = PyBytes_AS_STRING(bytes);
+		size = PyBytes_GET_SIZE(bytes);
+	}
+
+	if (memchr(data, '\0', size) != NULL)
+	{
+		Py_XDECREF(bytes);
+		return(false);
+	}
+
+	if (typoid == NAMEOID)
+	{
+		Name n;
+
+		/*
+		 * Same as namein.
+		 */
+		if (size >= NAMEDATALEN)
+			size = pg_mbcliplen(data, size, NAMEDATALEN - 1);
+
+		n = (Name) palloc0(NAMEDATALEN);
+		Py_MEMCPY(NameStr(*n), data, size);
+		*out = NameGetDatum(n);
+	}
+	else
+	{
+		text *t;
+
+		t = (text *) palloc(size + VARHDRSZ);
+		SET_VARSIZE(t, size + VARHDRSZ);
+		Py_MEMCPY(VARDATA(t), data, size);
+		*out = PointerGetDatum(t);
+	}
+	Py_XDECREF(bytes);
+
+	return(true);
+}
+
+static PyObj
+string_str(PyObj self)
+{
+	PyObj rob;
+
+	rob = PyPgString_FromDatum(PyPgType_GetOid(Py_TYPE(self)),
+		PyPgObject_GetDatum(self));
+	if (rob != NULL || PyErr_Occurred())
+		return(rob);
+
+	return(PyPgType_typoutput((PyObj) Py_TYPE(self), self));
+}
+
 static PyObj
 string_add(PyObj self, PyObj with)
 {
@@ -71,7 +234,7 @@ PyPgTypeObject PyPgString_Type = {{
 	NULL,											/* tp_as_mapping */
 	NULL,											/* tp_hash */
 	NULL,											/* tp_call */
-	NULL,											/* tp_str */
+	string_str,										/* tp_str */
 	NULL,											/* tp_getattro */
 	NULL,											/* tp_setattro */
 	NULL,											/* tp_as_buffer */
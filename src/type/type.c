@@ -31,6 +31,8 @@
 #include "utils/builtins.h"
 #include "utils/array.h"
 #include "utils/datum.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relcache.h"
@@ -45,6 +47,8 @@
 #include "pypg/extension.h"
 #include "pypg/pl.h"
 #include "pypg/error.h"
+#include "pypg/ist.h"
+#include "pypg/stats.h"
 #include "pypg/tupledesc.h"
 #include "pypg/type/type.h"
 #include "pypg/type/object.h"
@@ -58,6 +62,45 @@
 
 static PyObj type_anonymous_composites = NULL;
 static PyObj type_cache = NULL;
+
+/*
+ * Cast pathway cache used by PyPgType_typcast.
+ *
+ * Maps (source, target) to the pg_cast strategy resolved for the pair,
+ * including pairs that have no usable cast. The FmgrInfo of cast functions
+ * is kept so that fmgr_info is not repeated for every conversion.
+ *
+ * Any change to pg_cast marks the whole cache invalid; it's rebuilt on the
+ * next lookup. Each table is allocated in its own child of
+ * cast_cache_context, and the tables that were replaced while a cast function
+ * was running are only freed by a rebuild that happens when none are: the
+ * running call's entry and the fn_extra of its FmgrInfo are still in use.
+ */
+struct cast_key {
+	Oid ck_source;
+	Oid ck_target;
+};
+
+struct cast_entry {
+	struct cast_key ce_key;		/* hash key */
+	char ce_method;				/* CASTMETHOD_* or CAST_NONE */
+	FmgrInfo ce_flinfo;			/* valid when ce_method is CASTMETHOD_FUNCTION */
+};
+#define CAST_NONE '\0'
+
+/*
+ * Incremented whenever pg_constraint changes. Domains compare it with the
+ * generation of their constraint_list to identify when the list needs to be
+ * reloaded.
+ */
+static unsigned long domain_constraint_generation = 1;
+
+static MemoryContext cast_cache_context = NULL;
+static MemoryContext cast_table_context = NULL;
+static HTAB *cast_cache = NULL;
+static bool cast_cache_valid = false;
+/* The number of cast function calls in progress */
+static int cast_cache_calls = 0;
 /*
  * Initialized in PyPgType_Init for tupledesc.c.
  */
@@ -71,6 +114,7 @@ void
 PyPgClearTypeCache(void)
 {
 	PyDict_Clear(type_cache);
+	cast_cache_valid = false;
 }
 
 static bool
@@ -168,6 +212,59 @@ clear_typinfo(PyPgTypeInfo typinfo)
 	}
 }
 
+#if PG_VERSION_NUM >= 90200
+static void
+domain_constraints_invalidate(Datum arg, int cacheid, uint32 hashvalue)
+#else
+static void
+domain_constraints_invalidate(Datum arg, int cacheid, ItemPointer tuplePtr)
+#endif
+{
+	++domain_constraint_generation;
+}
+
+/*
+ * load_domain_constraints - (re)build the domain's constraint_list
+ *
+ * Everything is allocated in the domain's constraint_memory, so the previous
+ * list and the ExprContext are released by the reset.
+ *
+ * ON ERROR: Postgres elog
+ */
+static void
+load_domain_constraints(PyPgTypeInfo typinfo)
+{
+	static bool registered = false;
+	struct pypg_domain_data *dd = &(typinfo->domain.x_yes);
+	MemoryContext former;
+
+	if (!registered)
+	{
+		CacheRegisterSyscacheCallback(CONSTROID,
+			domain_constraints_invalidate, (Datum) 0);
+		registered = true;
+	}
+
+	dd->constraint_list = NIL;
+	dd->econtext = NULL;
+	MemoryContextResetAndDeleteChildren(dd->constraint_memory);
+
+	former = MemoryContextSwitchTo(dd->constraint_memory);
+	PG_TRY();
+	{
+		dd->constraint_list = GetDomainConstraints(typinfo->typoid);
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(former);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	MemoryContextSwitchTo(former);
+
+	dd->constraint_generation = domain_constraint_generation;
+}
+
 /*
  * inherit_typinfo - fill in the typinfo field using super.
  *
@@ -443,10 +540,14 @@ fill_pg_type(PyPgTypeInfo typinfo)
 			 */
 			typinfo->typfunc = NULL;
 
-			MemoryContextSwitchTo(typinfo->typmemory);
-			typinfo->domain.x_yes.constraint_list =
-				GetDomainConstraints(typinfo->typoid);
-			MemoryContextSwitchTo(former);
+			typinfo->domain.x_yes.constraint_memory =
+				AllocSetContextCreate(typinfo->typmemory,
+					"domain constraints",
+					ALLOCSET_SMALL_MINSIZE,
+					ALLOCSET_SMALL_INITSIZE,
+					ALLOCSET_SMALL_MAXSIZE);
+			typinfo->domain.x_yes.check_depth = 0;
+			load_domain_constraints(typinfo);
 
 			/*
 			 * Builtin DOMAIN? nah.
@@ -860,6 +961,7 @@ PyPgType_FromOid(Oid typoid)
 				/*
 				 * It's up-to-date. Return the object.
 				 */
+				++(pl_stats.st_type_cache_hits);
 				Py_DECREF(typoid_ob);
 				Py_INCREF(rob);
 				return(rob);
@@ -882,6 +984,7 @@ PyPgType_FromOid(Oid typoid)
 		 * Type was not in cache, or was not up-to-date.
 		 * Make a new one.
 		 */
+		++(pl_stats.st_type_cache_misses);
 		typinfo.typoid = typoid;
 		if (fill_pg_type(&typinfo))
 		{
@@ -1388,47 +1491,188 @@ PyPgType_typinput(
 	PG_END_TRY();
 }
 
+#if PG_VERSION_NUM >= 90200
+static void
+cast_cache_invalidate(Datum arg, int cacheid, uint32 hashvalue)
+#else
+static void
+cast_cache_invalidate(Datum arg, int cacheid, ItemPointer tuplePtr)
+#endif
+{
+	cast_cache_valid = false;
+}
+
+/*
+ * cast_cache_lookup - get the cast pathway for the (source, target) pair
+ *
+ * ON ERROR: Postgres elog
+ */
+static struct cast_entry *
+cast_cache_lookup(Oid from, Oid to)
+{
+	struct cast_key key;
+	struct cast_entry *entry;
+	HeapTuple tup;
+	char method = CAST_NONE;
+	FmgrInfo flinfo;
+	bool found;
+
+	if (cast_cache == NULL || !cast_cache_valid)
+	{
+		HASHCTL ctl;
+
+		if (cast_cache_context == NULL)
+		{
+			cast_cache_context = AllocSetContextCreate(TopMemoryContext,
+				"Python cast cache",
+				ALLOCSET_SMALL_MINSIZE,
+				ALLOCSET_SMALL_INITSIZE,
+				ALLOCSET_SMALL_MAXSIZE);
+			CacheRegisterSyscacheCallback(CASTSOURCETARGET,
+				cast_cache_invalidate, (Datum) 0);
+		}
+		else if (cast_cache_calls == 0)
+		{
+			/*
+			 * Frees the tables and the cast functions' fn_extra.
+			 */
+			MemoryContextDeleteChildren(cast_cache_context);
+		}
+		cast_cache = NULL;
+
+		cast_table_context = AllocSetContextCreate(cast_cache_context,
+			"Python cast pathways",
+			ALLOCSET_SMALL_MINSIZE,
+			ALLOCSET_SMALL_INITSIZE,
+			ALLOCSET_SMALL_MAXSIZE);
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(struct cast_key);
+		ctl.entrysize = sizeof(struct cast_entry);
+		ctl.hash = tag_hash;
+		ctl.hcxt = cast_table_context;
+		cast_cache = hash_create("Python cast pathways", 32,
+			&ctl, HASH_ELEM | HASH_FUNCTION | HASH_CONTEXT);
+		cast_cache_valid = true;
+	}
+
+	MemSet(&key, 0, sizeof(key));
+	key.ck_source = from;
+	key.ck_target = to;
+
+	entry = (struct cast_entry *) hash_search(cast_cache,
+		(void *) &key, HASH_FIND, NULL);
+	if (entry != NULL)
+		return(entry);
+
+	/*
+	 * Resolve before entering so that an error doesn't leave an incomplete
+	 * entry behind.
+	 */
+	tup = SearchSysCache(CASTSOURCETARGET,
+		ObjectIdGetDatum(from), ObjectIdGetDatum(to), 0, 0
+	);
+	if (HeapTupleIsValid(tup))
+	{
+		Form_pg_cast castform = (Form_pg_cast) GETSTRUCT(tup);
+
+		method = castform->castmethod;
+		if (method == CASTMETHOD_FUNCTION)
+		{
+			if (OidIsValid(castform->castfunc))
+				fmgr_info_cxt(castform->castfunc, &flinfo, cast_table_context);
+			else
+				method = CAST_NONE;
+		}
+		ReleaseSysCache(tup);
+	}
+
+	entry = (struct cast_entry *) hash_search(cast_cache,
+		(void *) &key, HASH_ENTER, &found);
+	entry->ce_method = method;
+	if (method == CASTMETHOD_FUNCTION)
+		entry->ce_flinfo = flinfo;
+
+	return(entry);
+}
+
+/*
+ * copy_datum - datumCopy that detoasts varlenas
+ *
+ * Objects created by PyPgObject_NewToasted hold toast pointers that must not
+ * be copied into other Datums.
+ */
+static Datum
+copy_datum(Datum d, bool typbyval, int typlen)
+{
+	if (!typbyval && typlen == -1)
+		return(PointerGetDatum(PG_DETOAST_DATUM_COPY(d)));
+
+	return(datumCopy(d, typbyval, typlen));
+}
+
 int
 PyPgType_typcast(
 	PyObj subtype, PyObj ob, int32 mod,
 	Datum *rdatum, bool *isnull)
 {
-	Oid to, from, castor;
+	Oid to, from;
 	Datum ind;
-	HeapTuple tup;
 	PyPgTypeInfo typinfo;
+	struct cast_entry *cast;
 
 	ind = PyPgObject_GetDatum(ob);
 	from = PyPgType_GetOid(Py_TYPE(ob));
 	typinfo = PyPgTypeInfo(subtype);
 	to = typinfo->typoid;
 
-	tup = SearchSysCache(CASTSOURCETARGET,
-		ObjectIdGetDatum(from), ObjectIdGetDatum(to), 0, 0
-	);
-	/*
-	 * No cast available.
-	 */
-	if (!HeapTupleIsValid(tup))
-		return(1);
-
-	castor = ((Form_pg_cast) GETSTRUCT(tup))->castfunc;
-	ReleaseSysCache(tup);
+	cast = cast_cache_lookup(from, to);
+	switch (cast->ce_method)
+	{
+		case CASTMETHOD_FUNCTION:
+			/*
+			 * indatum, typmod, and isexplicit.
+			 */
+			++cast_cache_calls;
+			PG_TRY();
+			{
+				*rdatum = FunctionCall3(&(cast->ce_flinfo),
+					ind, Int32GetDatum(mod), BoolGetDatum(true));
+			}
+			PG_CATCH();
+			{
+				--cast_cache_calls;
+				PG_RE_THROW();
+			}
+			PG_END_TRY();
+			--cast_cache_calls;
+		break;
 
-	if (!OidIsValid(castor))
-		return(1);
+		case CASTMETHOD_BINARY:
+			/*
+			 * Binary coercible, but a typmod needs to be applied by the
+			 * target's typinput.
+			 */
+			if (mod != -1)
+				return(1);
+			*rdatum = ind;
+		break;
 
-	/*
-	 * indatum, typmod, and isexplicit.
-	 */
-	*rdatum = OidFunctionCall3(castor, ind, mod, BoolGetDatum(true));
+		default:
+			/*
+			 * No cast, or an I/O conversion cast. The caller falls back to
+			 * typinput, which is exactly what the latter would do.
+			 */
+			return(1);
+		break;
+	}
 	*isnull = false;
 	if (*rdatum == ind)
 	{
 		/*
 		 * That's another object's Datum.
 		 */
-		*rdatum = datumCopy(
+		*rdatum = copy_datum(
 			PyPgObject_GetDatum(ob),
 			typinfo->typbyval,
 			typinfo->typlen
@@ -1439,82 +1683,153 @@ PyPgType_typcast(
 }
 
 /*
- * check_constraints - check domain constraints
+ * check_domain_values - check the values against the constraints
  *
- * This is extremely similar to domain_check_input in domain.c
+ * This is extremely similar to domain_check_input in domain.c. The
+ * per-tuple memory of the econtext is reset between values.
  */
 static void
-check_constraints(PyObj subtype, Datum value, bool isnull)
+check_domain_values(PyPgTypeInfo typinfo, List *constraints,
+	ExprContext *econtext, Datum *values, bool *nulls, int nvalues)
 {
-	PyPgTypeInfo typinfo;
-	ExprContext *econtext = NULL;
 	ListCell   *l;
+	int i;
 
-	typinfo = PyPgTypeInfo(subtype);
+	for (i = 0; i < nvalues; ++i)
+	{
+		Datum value = values[i];
+		bool isnull = nulls != NULL && nulls[i];
 
-	if (isnull && typinfo->domain.x_yes.typnotnull)
-		ereport(ERROR,
-				(errcode(ERRCODE_NOT_NULL_VIOLATION),
-				 errmsg("domain %s does not allow null values",
-						format_type_be(typinfo->typoid))));
+		if (isnull && typinfo->domain.x_yes.typnotnull)
+			ereport(ERROR,
+					(errcode(ERRCODE_NOT_NULL_VIOLATION),
+					 errmsg("domain %s does not allow null values",
+							format_type_be(typinfo->typoid))));
 
-	foreach(l, typinfo->domain.x_yes.constraint_list)
+		foreach(l, constraints)
+		{
+			DomainConstraintState *con = (DomainConstraintState *) lfirst(l);
+
+			switch (con->constrainttype)
+			{
+				case DOM_CONSTRAINT_NOTNULL:
+					if (isnull)
+						ereport(ERROR,
+								(errcode(ERRCODE_NOT_NULL_VIOLATION),
+								 errmsg("domain %s does not allow null values",
+										format_type_be(typinfo->typoid))));
+					break;
+				case DOM_CONSTRAINT_CHECK:
+					{
+						Datum		conResult;
+						bool		conIsNull;
+
+						/*
+						 * Clear anything left by a prior value, or by a
+						 * check that failed.
+						 */
+						ResetExprContext(econtext);
+
+						/*
+						 * Set up value to be returned by CoerceToDomainValue
+						 * nodes. The econtext is not used by anything else
+						 * while the expression is evaluated, so there is no
+						 * need to save and restore the fields.
+						 */
+						econtext->domainValue_datum = value;
+						econtext->domainValue_isNull = isnull;
+
+						conResult = ExecEvalExprSwitchContext(con->check_expr,
+															  econtext,
+															  &conIsNull, NULL);
+
+						if (!conIsNull && !DatumGetBool(conResult))
+							ereport(ERROR,
+									(errcode(ERRCODE_CHECK_VIOLATION),
+									 errmsg("value for domain %s violates check constraint \"%s\"",
+											format_type_be(typinfo->typoid),
+											con->name)));
+						break;
+					}
+				default:
+					elog(ERROR, "unrecognized constraint type: %d",
+						 (int) con->constrainttype);
+					break;
+			}
+		}
+	}
+}
+
+/*
+ * check_constraints_many - check domain constraints of a set of values
+ *
+ * The constraint list and ExprContext are kept by the domain, and the list
+ * is reloaded when pg_constraint has changed.
+ */
+static void
+check_constraints_many(PyObj subtype, Datum *values, bool *nulls, int nvalues)
+{
+	PyPgTypeInfo typinfo;
+	struct pypg_domain_data *dd;
+
+	typinfo = PyPgTypeInfo(subtype);
+	dd = &(typinfo->domain.x_yes);
+
+	if (dd->check_depth > 0)
 	{
-		DomainConstraintState *con = (DomainConstraintState *) lfirst(l);
+		List *constraints;
+		ExprContext *econtext;
 
-		switch (con->constrainttype)
-		{
-			case DOM_CONSTRAINT_NOTNULL:
-				if (isnull)
-					ereport(ERROR,
-							(errcode(ERRCODE_NOT_NULL_VIOLATION),
-							 errmsg("domain %s does not allow null values",
-									format_type_be(typinfo->typoid))));
-				break;
-			case DOM_CONSTRAINT_CHECK:
-				{
-					Datum		conResult;
-					bool		conIsNull;
+		/*
+		 * A CHECK of the domain called a function that checks a value of the
+		 * same domain. The outer check is still evaluating the domain's
+		 * expressions with its econtext, so neither may be reset or reloaded
+		 * here. Use a private list and ExprContext, as domain_check_input does.
+		 */
+		constraints = GetDomainConstraints(typinfo->typoid);
+		econtext = CreateStandaloneExprContext();
+		check_domain_values(typinfo, constraints, econtext,
+			values, nulls, nvalues);
+		FreeExprContext(econtext, true);
+		return;
+	}
 
-					/* Make the econtext if we didn't already */
-					if (econtext == NULL)
-						econtext = CreateStandaloneExprContext();
+	if (dd->constraint_generation != domain_constraint_generation)
+		load_domain_constraints(typinfo);
 
-					/*
-					 * Set up value to be returned by CoerceToDomainValue
-					 * nodes.  Unlike ExecEvalCoerceToDomain, this econtext
-					 * couldn't be shared with anything else, so no need to
-					 * save and restore fields.
-					 */
-					econtext->domainValue_datum = value;
-					econtext->domainValue_isNull = isnull;
+	if (dd->econtext == NULL)
+	{
+		MemoryContext former;
 
-					conResult = ExecEvalExprSwitchContext(con->check_expr,
-														  econtext,
-														  &conIsNull, NULL);
+		former = MemoryContextSwitchTo(dd->constraint_memory);
+		dd->econtext = CreateStandaloneExprContext();
+		MemoryContextSwitchTo(former);
+	}
 
-					if (!conIsNull && !DatumGetBool(conResult))
-						ereport(ERROR,
-								(errcode(ERRCODE_CHECK_VIOLATION),
-								 errmsg("value for domain %s violates check constraint \"%s\"",
-										format_type_be(typinfo->typoid),
-										con->name)));
-					break;
-				}
-			default:
-				elog(ERROR, "unrecognized constraint type: %d",
-					 (int) con->constrainttype);
-				break;
-		}
+	++(dd->check_depth);
+	PG_TRY();
+	{
+		check_domain_values(typinfo, dd->constraint_list, dd->econtext,
+			values, nulls, nvalues);
 	}
+	PG_CATCH();
+	{
+		--(dd->check_depth);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	--(dd->check_depth);
 
 	/*
-	 * Before exiting, call any shutdown callbacks and reset econtext's
-	 * per-tuple memory.  This avoids leaking non-memory resources, if
-	 * anything in the expression(s) has any.
+	 * Don't hold on to the per-tuple memory of the last check.
 	 */
-	if (econtext)
-		FreeExprContext(econtext, true);
+	ResetExprContext(dd->econtext);
+}
+
+static void
+check_constraints(PyObj subtype, Datum value, bool isnull)
+{
+	check_constraints_many(subtype, &value, &isnull, 1);
 }
 
 PyObj
@@ -1876,6 +2191,89 @@ type_check_constraints(PyObj self, PyObj ob)
 	return(Py_None);
 }
 
+/*
+ * Check many values at once; the constraint state is prepared once.
+ */
+static PyObj
+type_check_constraints_all(PyObj self, PyObj iter)
+{
+	PyObj seq;
+	Py_ssize_t i, n;
+	Datum *values;
+	bool *nulls;
+	volatile bool failed = false;
+
+	seq = PySequence_Fast(iter, "check_all requires an iterable");
+	if (seq == NULL)
+		return(NULL);
+	n = PySequence_Fast_GET_SIZE(seq);
+
+	for (i = 0; i < n; ++i)
+	{
+		PyObj ob = PySequence_Fast_GET_ITEM(seq, i);
+
+		if (ob != Py_None && (PyTypeObject *) self != Py_TYPE(ob))
+		{
+			PyErr_SetString(PyExc_TypeError,
+				"objects must be exact instances of the domain type");
+			Py_DECREF(seq);
+			return(NULL);
+		}
+	}
+
+	if (!PyPgType_IsDomain(self) || n == 0)
+	{
+		Py_DECREF(seq);
+		Py_INCREF(Py_None);
+		return(Py_None);
+	}
+
+	if (DB_IS_NOT_READY())
+	{
+		Py_DECREF(seq);
+		return(NULL);
+	}
+
+	values = PyMem_Malloc(sizeof(Datum) * n);
+	nulls = PyMem_Malloc(sizeof(bool) * n);
+	if (values == NULL || nulls == NULL)
+	{
+		PyMem_Free(values);
+		PyMem_Free(nulls);
+		Py_DECREF(seq);
+		return(PyErr_NoMemory());
+	}
+
+	for (i = 0; i < n; ++i)
+	{
+		PyObj ob = PySequence_Fast_GET_ITEM(seq, i);
+
+		nulls[i] = (ob == Py_None);
+		values[i] = nulls[i] ? 0 : PyPgObject_GetDatum(ob);
+	}
+
+	PG_TRY();
+	{
+		check_constraints_many(self, values, nulls, (int) n);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+		failed = true;
+	}
+	PG_END_TRY();
+
+	PyMem_Free(values);
+	PyMem_Free(nulls);
+	Py_DECREF(seq);
+
+	if (failed)
+		return(NULL);
+
+	Py_INCREF(Py_None);
+	return(Py_None);
+}
+
 static PyObj
 type_from_relation_id(PyObj subtype, PyObj oid_ob)
 {
@@ -1911,6 +2309,8 @@ static PyMethodDef PyPgType_Methods[] = {
 	PyDoc_STR("call the type's modout function")},
 	{"check", (PyCFunction) type_check_constraints, METH_O,
 	PyDoc_STR("validate that the object meets the type's constraints(DOMAINs)")},
+	{"check_all", (PyCFunction) type_check_constraints_all, METH_O,
+	PyDoc_STR("validate that all the objects in the iterable meet the type's constraints")},
 	{NULL,}
 };
 
@@ -2321,7 +2721,7 @@ PyPgType_DatumNew(
 			/*
 			 * It's the same thang. datumCopy away.
 			 */
-			*rdatum = datumCopy(
+			*rdatum = copy_datum(
 				PyPgObject_GetDatum(ob),
 				typinfo->typbyval,
 				typinfo->typlen
@@ -2345,7 +2745,14 @@ PyPgType_DatumNew(
 	}
 	else if (tp_new_datum == NULL || PyUnicode_Check(ob))
 	{
-		PyPgType_typinput(subtype, ob, mod, rdatum, isnull);
+		/*
+		 * str to text-like types can skip typinput.
+		 */
+		if (mod == -1 && PyUnicode_CheckExact(ob) &&
+			PyPgString_DatumFromPyUnicode(typinfo->typoid, ob, rdatum))
+			*isnull = false;
+		else
+			PyPgType_typinput(subtype, ob, mod, rdatum, isnull);
 	}
 	else
 	{
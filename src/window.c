@@ -0,0 +1,521 @@
+/*
+ * window.c - Postgres.Window
+ *
+ * Python functions declared as WINDOW functions are given a Postgres.Window
+ * object as the first argument of main. The object provides access to the
+ * rows of the current partition and frame, and holds a state object that
+ * persists across the rows of the partition.
+ */
+#include <setjmp.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "windowapi.h"
+#include "access/tupdesc.h"
+#include "utils/memutils.h"
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/extension.h"
+#include "pypg/error.h"
+#include "pypg/aggregate.h"
+#include "pypg/tupledesc.h"
+#include "pypg/type/type.h"
+#include "pypg/type/object.h"
+#include "pypg/window.h"
+
+/*
+ * Get the WindowObject or set an exception if the call has returned.
+ */
+static WindowObject
+window_object(PyObj self)
+{
+	WindowObject winobj = PyPgWindow_GetObject(self);
+
+	if (winobj == NULL)
+	{
+		PyErr_SetString(PyExc_RuntimeError,
+			"window object can only be used by the call it was given to");
+	}
+
+	return(winobj);
+}
+
+static int
+window_check_argno(PyObj self, int argno)
+{
+	if (argno < 0 || argno >= PyPgTupleDesc_GetNatts(PyPgWindow_GetInput(self)))
+	{
+		PyErr_Format(PyExc_IndexError,
+			"window function has no argument %d", argno);
+		return(-1);
+	}
+
+	return(0);
+}
+
+/*
+ * The state Datum of the partition; allocated on first use.
+ */
+static Datum
+window_state(WindowObject winobj)
+{
+	void * volatile mem = NULL;
+
+	PG_TRY();
+	{
+		mem = WinGetPartitionLocalMemory(winobj, agg_state_size());
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (mem == NULL)
+		return(0);
+
+	return(agg_init_state(mem));
+}
+
+/*
+ * Convert the Datum of the argument.
+ */
+static PyObj
+window_value(PyObj self, int argno, Datum d, bool isnull)
+{
+	if (isnull)
+	{
+		Py_INCREF(Py_None);
+		return(Py_None);
+	}
+
+	return(PyPgObject_New(
+		PyPgTupleDesc_GetAttributeType(PyPgWindow_GetInput(self), argno), d));
+}
+
+/*
+ * Fetch the argument from a row of the frame or the partition.
+ *
+ * Returns false when the row is outside of the frame or partition.
+ */
+static bool
+window_fetch(WindowObject winobj, bool frame, int argno, int relpos,
+	int seektype, bool set_mark, Datum *d, bool *isnull, bool *failed)
+{
+	volatile bool isout = true;
+
+	*failed = false;
+	PG_TRY();
+	{
+		bool out = false;
+
+		if (frame)
+			*d = WinGetFuncArgInFrame(winobj, argno, relpos, seektype,
+				set_mark, isnull, &out);
+		else
+			*d = WinGetFuncArgInPartition(winobj, argno, relpos, seektype,
+				set_mark, isnull, &out);
+		isout = out;
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+		*failed = true;
+	}
+	PG_END_TRY();
+
+	return(!isout);
+}
+
+static PyObj
+window_get_arg(PyObj self, PyObj args, PyObj kw, bool frame)
+{
+	static char *words[] = {"argno", "relpos", "seektype", "set_mark", NULL};
+	WindowObject winobj;
+	int argno, relpos, seektype = WINDOW_SEEK_CURRENT;
+	PyObj set_mark = Py_False;
+	Datum d = 0;
+	bool isnull = true, failed;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "ii|iO", words,
+			&argno, &relpos, &seektype, &set_mark))
+		return(NULL);
+
+	winobj = window_object(self);
+	if (winobj == NULL || window_check_argno(self, argno) == -1)
+		return(NULL);
+
+	if (!window_fetch(winobj, frame, argno, relpos, seektype,
+			PyObject_IsTrue(set_mark) == 1, &d, &isnull, &failed))
+	{
+		if (!failed)
+			PyErr_Format(PyExc_IndexError, "row is outside of the %s",
+				frame ? "frame" : "partition");
+		return(NULL);
+	}
+
+	return(window_value(self, argno, d, isnull));
+}
+
+static PyObj
+window_arg_in_frame(PyObj self, PyObj args, PyObj kw)
+{
+	return(window_get_arg(self, args, kw, true));
+}
+
+static PyObj
+window_arg_in_partition(PyObj self, PyObj args, PyObj kw)
+{
+	return(window_get_arg(self, args, kw, false));
+}
+
+/*
+ * Build a list of the argument's values in the frame or the partition.
+ */
+static PyObj
+window_get_all(PyObj self, PyObj args, bool frame)
+{
+	WindowObject winobj;
+	int argno = 0, relpos;
+	PyObj rob;
+
+	if (!PyArg_ParseTuple(args, "|i", &argno))
+		return(NULL);
+
+	winobj = window_object(self);
+	if (winobj == NULL || window_check_argno(self, argno) == -1)
+		return(NULL);
+
+	rob = PyList_New(0);
+	if (rob == NULL)
+		return(NULL);
+
+	for (relpos = 0; ; ++relpos)
+	{
+		Datum d = 0;
+		bool isnull = true, failed;
+		PyObj ob;
+		int r;
+
+		if (!window_fetch(winobj, frame, argno, relpos, WINDOW_SEEK_HEAD,
+				false, &d, &isnull, &failed))
+		{
+			if (failed)
+			{
+				Py_DECREF(rob);
+				return(NULL);
+			}
+			break;
+		}
+
+		ob = window_value(self, argno, d, isnull);
+		if (ob == NULL)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+		r = PyList_Append(rob, ob);
+		Py_DECREF(ob);
+		if (r == -1)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+	}
+
+	return(rob);
+}
+
+static PyObj
+window_frame(PyObj self, PyObj args)
+{
+	return(window_get_all(self, args, true));
+}
+
+static PyObj
+window_partition(PyObj self, PyObj args)
+{
+	return(window_get_all(self, args, false));
+}
+
+static PyObj
+window_current_position(PyObj self)
+{
+	WindowObject winobj = window_object(self);
+	volatile int64 pos = 0;
+
+	if (winobj == NULL)
+		return(NULL);
+
+	PG_TRY();
+	{
+		pos = WinGetCurrentPosition(winobj);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	return(PyLong_FromLongLong((PY_LONG_LONG) pos));
+}
+
+static PyObj
+window_partition_row_count(PyObj self)
+{
+	WindowObject winobj = window_object(self);
+	volatile int64 count = 0;
+
+	if (winobj == NULL)
+		return(NULL);
+
+	PG_TRY();
+	{
+		count = WinGetPartitionRowCount(winobj);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	return(PyLong_FromLongLong((PY_LONG_LONG) count));
+}
+
+static PyObj
+window_set_mark(PyObj self, PyObj args)
+{
+	WindowObject winobj;
+	PY_LONG_LONG pos;
+
+	if (!PyArg_ParseTuple(args, "L", &pos))
+		return(NULL);
+
+	winobj = window_object(self);
+	if (winobj == NULL)
+		return(NULL);
+
+	PG_TRY();
+	{
+		WinSetMarkPosition(winobj, (int64) pos);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	Py_RETURN_NONE;
+}
+
+static PyObj
+window_rows_are_peers(PyObj self, PyObj args)
+{
+	WindowObject winobj;
+	PY_LONG_LONG pos1, pos2;
+	volatile bool r = false;
+
+	if (!PyArg_ParseTuple(args, "LL", &pos1, &pos2))
+		return(NULL);
+
+	winobj = window_object(self);
+	if (winobj == NULL)
+		return(NULL);
+
+	PG_TRY();
+	{
+		r = WinRowsArePeers(winobj, (int64) pos1, (int64) pos2);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	return(PyBool_FromLong(r));
+}
+
+static PyMethodDef PyPgWindow_Methods[] = {
+	{"arg_in_frame", (PyCFunction) window_arg_in_frame,
+		METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("get the argument's value at a row of the frame")},
+	{"arg_in_partition", (PyCFunction) window_arg_in_partition,
+		METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("get the argument's value at a row of the partition")},
+	{"frame", (PyCFunction) window_frame, METH_VARARGS,
+		PyDoc_STR("get a list of the argument's values in the frame")},
+	{"partition", (PyCFunction) window_partition, METH_VARARGS,
+		PyDoc_STR("get a list of the argument's values in the partition")},
+	{"current_position", (PyCFunction) window_current_position, METH_NOARGS,
+		PyDoc_STR("get the position of the current row in the partition")},
+	{"partition_row_count", (PyCFunction) window_partition_row_count, METH_NOARGS,
+		PyDoc_STR("get the number of rows in the partition")},
+	{"set_mark", (PyCFunction) window_set_mark, METH_VARARGS,
+		PyDoc_STR("allow the rows before the position to be discarded")},
+	{"rows_are_peers", (PyCFunction) window_rows_are_peers, METH_VARARGS,
+		PyDoc_STR("whether the rows at the positions are peers")},
+	{NULL}
+};
+
+static PyObj
+window_get_state(PyObj self, void *closure)
+{
+	WindowObject winobj = window_object(self);
+	Datum d;
+	PyObj rob;
+
+	if (winobj == NULL)
+		return(NULL);
+
+	d = window_state(winobj);
+	if (d == 0)
+		return(NULL);
+
+	rob = agg_get_state(d);
+	Py_XINCREF(rob);
+	return(rob);
+}
+
+static int
+window_set_state(PyObj self, PyObj ob, void *closure)
+{
+	WindowObject winobj = window_object(self);
+	Datum d;
+
+	if (winobj == NULL)
+		return(-1);
+
+	d = window_state(winobj);
+	if (d == 0)
+		return(-1);
+
+	if (ob == NULL || ob == Py_None)
+	{
+		agg_release_state(d);
+		return(0);
+	}
+
+	if (agg_set_state(NULL, d, false, ob) == 0)
+		return(-1);
+
+	return(0);
+}
+
+static PyGetSetDef PyPgWindow_GetSet[] = {
+	{"state", window_get_state, window_set_state,
+		PyDoc_STR("object kept across the rows of the partition")},
+	{NULL}
+};
+
+PyObj
+PyPgWindow_New(WindowObject winobj, PyObj input)
+{
+	PyObj rob;
+
+	rob = PyPgWindow_Type.tp_alloc(&PyPgWindow_Type, 0);
+	if (rob == NULL)
+		return(NULL);
+
+	PyPgWindow_SetObject(rob, winobj);
+	PyPgWindow_SetInput(rob, input);
+	Py_INCREF(input);
+
+	return(rob);
+}
+
+#if PG_VERSION_NUM < 90500
+void
+PyPgWindow_EndRow(WindowObject winobj, int nargs)
+{
+	Datum d;
+	bool isnull, isout = false;
+
+	d = agg_init_state(WinGetPartitionLocalMemory(winobj, agg_state_size()));
+	if (agg_get_state(d) == Py_None)
+		return;
+
+	/*
+	 * Look for the next row rather than counting the rows, which would read
+	 * the rest of the partition on every row.
+	 */
+	if (nargs > 0)
+		WinGetFuncArgInPartition(winobj, 0, 1, WINDOW_SEEK_CURRENT, false,
+			&isnull, &isout);
+	else
+		isout = WinGetCurrentPosition(winobj) == WinGetPartitionRowCount(winobj) - 1;
+
+	if (isout)
+		agg_release_state(d);
+}
+#endif
+
+static void
+window_dealloc(PyObj self)
+{
+	PyObj ob;
+
+	ob = PyPgWindow_GetInput(self);
+	PyPgWindow_SetInput(self, NULL);
+	Py_XDECREF(ob);
+
+	Py_TYPE(self)->tp_free(self);
+}
+
+const char PyPgWindow_Doc[] = "Access to the partition of a WINDOW function call";
+PyTypeObject PyPgWindow_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"Postgres.Window",					/* tp_name */
+	sizeof(struct PyPgWindow),			/* tp_basicsize */
+	0,									/* tp_itemsize */
+	window_dealloc,						/* tp_dealloc */
+	NULL,								/* tp_print */
+	NULL,								/* tp_getattr */
+	NULL,								/* tp_setattr */
+	NULL,								/* tp_compare */
+	NULL,								/* tp_repr */
+	NULL,								/* tp_as_number */
+	NULL,								/* tp_as_sequence */
+	NULL,								/* tp_as_mapping */
+	NULL,								/* tp_hash */
+	NULL,								/* tp_call */
+	NULL,								/* tp_str */
+	NULL,								/* tp_getattro */
+	NULL,								/* tp_setattro */
+	NULL,								/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT,					/* tp_flags */
+	PyPgWindow_Doc,						/* tp_doc */
+	NULL,								/* tp_traverse */
+	NULL,								/* tp_clear */
+	NULL,								/* tp_richcompare */
+	0,									/* tp_weaklistoffset */
+	NULL,								/* tp_iter */
+	NULL,								/* tp_iternext */
+	PyPgWindow_Methods,					/* tp_methods */
+	NULL,								/* tp_members */
+	PyPgWindow_GetSet,					/* tp_getset */
+	NULL,								/* tp_base */
+	NULL,								/* tp_dict */
+	NULL,								/* tp_descr_get */
+	NULL,								/* tp_descr_set */
+	0,									/* tp_dictoffset */
+	NULL,								/* tp_init */
+	NULL,								/* tp_alloc */
+	NULL,								/* tp_new */
+};
@@ -0,0 +1,819 @@
+/*
+ * Background workers; python.workers and Postgres.bgworker
+ *
+ * A worker connects to a database and repeatedly calls a function that takes
+ * no arguments and returns float8, each call in its own transaction. The
+ * result is the number of seconds to wait before the next call, and NULL ends
+ * the worker. Functions that consume a queue table can return zero while
+ * there is work left, and the wait otherwise.
+ *
+ * Workers listed in python.workers are registered when the extension is
+ * loaded by shared_preload_libraries(9.3 and later), and Postgres.bgworker
+ * starts a worker while the server is running(9.5 and later).
+ *
+ * A dynamic worker shares a dynamic shared memory segment with the backend
+ * that started it. The segment holds two shm_mq's, one in each direction,
+ * and both ends get a Postgres.MessageQueue for them.
+ */
+#include <setjmp.h>
+#include <ctype.h>
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+#include "utils/snapmgr.h"
+#if PG_VERSION_NUM >= 90300
+#include "postmaster/bgworker.h"
+#endif
+#if PG_VERSION_NUM >= 90500
+#include "storage/dsm.h"
+#include "storage/shm_mq.h"
+#endif
+#if PG_VERSION_NUM >= 100000
+#include "pgstat.h"
+#endif
+
+#include "pypg/python.h"
+#include "pypg/postgres.h"
+#include "pypg/extension.h"
+#include "pypg/error.h"
+#include "pypg/worker.h"
+
+char *pl_workers = NULL;
+
+#if PG_VERSION_NUM >= 90500
+/*
+ * Copied into bgw_extra by worker_start.
+ */
+struct worker_extra {
+	Oid we_database;			/* of the backend that started the worker */
+	Oid we_role;
+	dsm_handle we_segment;
+	Size we_queue_size;			/* MAXALIGN'd size of each queue */
+};
+
+/*
+ * The worker's ends of the queues; set by worker_attach.
+ */
+static dsm_segment *worker_segment = NULL;
+static shm_mq_handle *worker_send = NULL;
+static shm_mq_handle *worker_receive = NULL;
+static PyObj worker_queue_ob = NULL;
+#endif
+
+#if PG_VERSION_NUM >= 90300
+/*
+ * Get the database and function of the entry at the index of python.workers.
+ *
+ * Returns false when there is no such entry. The strings are set to NULL
+ * when the entry is malformed.
+ */
+static bool
+worker_entry(int index, char **database, char **function)
+{
+	char *list, *entry, *sep;
+	int i = 0;
+
+	*database = NULL;
+	*function = NULL;
+
+	if (pl_workers == NULL)
+		return(false);
+
+	list = pstrdup(pl_workers);
+	entry = list;
+
+	while (*entry != '\0')
+	{
+		char *end = strchr(entry, ',');
+
+		if (end != NULL)
+			*end = '\0';
+
+		while (isspace((unsigned char) *entry))
+			++entry;
+
+		if (*entry != '\0')
+		{
+			if (i == index)
+			{
+				char *last = entry + strlen(entry);
+
+				while (last > entry && isspace((unsigned char) last[-1]))
+					--last;
+				*last = '\0';
+
+				sep = strchr(entry, ':');
+				if (sep != NULL && sep != entry && sep[1] != '\0')
+				{
+					*sep = '\0';
+					*database = pstrdup(entry);
+					*function = pstrdup(sep + 1);
+				}
+
+				pfree(list);
+				return(true);
+			}
+			++i;
+		}
+
+		if (end == NULL)
+			break;
+		entry = end + 1;
+	}
+
+	pfree(list);
+	return(false);
+}
+
+/*
+ * Look up the function, and check that it can be called by a worker.
+ * Arguments may be omitted from the signature.
+ */
+static Oid
+worker_function(const char *function)
+{
+	char *signature;
+	Oid fn_oid;
+
+	if (strchr(function, '(') != NULL)
+		signature = pstrdup(function);
+	else
+	{
+		signature = palloc(strlen(function) + 3);
+		sprintf(signature, "%s()", function);
+	}
+
+	fn_oid = DatumGetObjectId(DirectFunctionCall1(regprocedurein,
+		CStringGetDatum(signature)));
+	pfree(signature);
+
+	if (get_func_nargs(fn_oid) != 0 || get_func_rettype(fn_oid) != FLOAT8OID)
+	{
+		ereport(ERROR,(
+			errcode(ERRCODE_INVALID_FUNCTION_DEFINITION),
+			errmsg("background worker functions must take no arguments and return float8"),
+			errdetail("The function \"%s\" cannot be used.", function)
+		));
+	}
+
+	return(fn_oid);
+}
+
+/*
+ * Call the function until it returns NULL.
+ *
+ * Errors are not caught, so they terminate the worker.
+ */
+static void
+worker_loop(const char *function, Oid fn_oid)
+{
+#if PG_VERSION_NUM >= 90500
+	Latch *latch = MyLatch;
+#else
+	Latch *latch = &MyProc->procLatch;
+#endif
+
+	for (;;)
+	{
+		FmgrInfo flinfo;
+		FunctionCallInfoData fcinfo;
+		Datum rd;
+		double delay = 0;
+		bool isnull;
+		int rc;
+
+		SetCurrentStatementStartTimestamp();
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		if (!OidIsValid(fn_oid))
+			fn_oid = worker_function(function);
+
+		fmgr_info(fn_oid, &flinfo);
+		InitFunctionCallInfoData(fcinfo, &flinfo, 0, InvalidOid, NULL, NULL);
+		rd = FunctionCallInvoke(&fcinfo);
+		isnull = fcinfo.isnull;
+		if (!isnull)
+			delay = DatumGetFloat8(rd);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+
+		if (isnull)
+			break;
+
+		if (delay < 0)
+			delay = 0;
+
+#if PG_VERSION_NUM >= 100000
+		rc = WaitLatch(latch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+			(long) (delay * 1000), PG_WAIT_EXTENSION);
+#else
+		rc = WaitLatch(latch, WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+			(long) (delay * 1000));
+#endif
+		ResetLatch(latch);
+
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		/*
+		 * SIGTERM is handled by die().
+		 */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	proc_exit(0);
+}
+#endif
+
+#if PG_VERSION_NUM >= 90500
+/*
+ * Map the segment created by worker_start and attach to the worker's ends of
+ * the queues. The mapping is kept for the life of the process.
+ */
+static void
+worker_attach(struct worker_extra *extra)
+{
+	MemoryContext former;
+	char *address;
+	shm_mq *to_worker, *from_worker;
+
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "python worker");
+	worker_segment = dsm_attach(extra->we_segment);
+	if (worker_segment == NULL)
+	{
+		ereport(ERROR,(
+			errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			errmsg("could not map the dynamic shared memory segment of the worker's queues")
+		));
+	}
+	dsm_pin_mapping(worker_segment);
+
+	address = dsm_segment_address(worker_segment);
+	to_worker = (shm_mq *) address;
+	from_worker = (shm_mq *) (address + extra->we_queue_size);
+	shm_mq_set_receiver(to_worker, MyProc);
+	shm_mq_set_sender(from_worker, MyProc);
+
+	former = MemoryContextSwitchTo(TopMemoryContext);
+	worker_receive = shm_mq_attach(to_worker, worker_segment, NULL);
+	worker_send = shm_mq_attach(from_worker, worker_segment, NULL);
+	MemoryContextSwitchTo(former);
+}
+#endif
+
+void
+pl_worker_main(Datum index)
+{
+#if PG_VERSION_NUM >= 90300
+	char *database, *function;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	if (!worker_entry(DatumGetInt32(index), &database, &function)
+		|| database == NULL)
+	{
+		ereport(FATAL,(
+			errmsg("python.workers entry %d is missing or malformed",
+				DatumGetInt32(index))
+		));
+	}
+
+#if PG_VERSION_NUM >= 110000
+	BackgroundWorkerInitializeConnection(database, NULL, 0);
+#else
+	BackgroundWorkerInitializeConnection(database, NULL);
+#endif
+	worker_loop(function, InvalidOid);
+#else
+	elog(FATAL, "background workers are not supported by this version of PostgreSQL");
+#endif
+}
+
+void
+pl_dynamic_worker_main(Datum fn_oid)
+{
+#if PG_VERSION_NUM >= 90500
+	struct worker_extra extra;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	memcpy(&extra, MyBgworkerEntry->bgw_extra, sizeof(extra));
+#if PG_VERSION_NUM >= 110000
+	BackgroundWorkerInitializeConnectionByOid(extra.we_database, extra.we_role, 0);
+#else
+	BackgroundWorkerInitializeConnectionByOid(extra.we_database, extra.we_role);
+#endif
+	worker_attach(&extra);
+	worker_loop(NULL, DatumGetObjectId(fn_oid));
+#else
+	elog(FATAL, "dynamic background workers are not supported by this version of PostgreSQL");
+#endif
+}
+
+void
+worker_init(void)
+{
+	static bool defined = false;
+#if PG_VERSION_NUM >= 90300
+	int i;
+	char *database, *function;
+#endif
+
+	if (defined)
+		return;
+
+#if PG_VERSION_NUM >= 90100
+	DefineCustomStringVariable("python.workers",
+		"Background workers to start with the server.",
+		"A comma separated list of database:function entries. Each "
+		"function is called by a background worker until it returns NULL. "
+		"Requires the extension to be loaded by shared_preload_libraries.",
+		&pl_workers, "",
+		PGC_POSTMASTER, 0, NULL, NULL, NULL);
+#else
+	DefineCustomStringVariable("python.workers",
+		"Background workers to start with the server.",
+		"A comma separated list of database:function entries. Each "
+		"function is called by a background worker until it returns NULL. "
+		"Requires the extension to be loaded by shared_preload_libraries.",
+		&pl_workers, "",
+		PGC_POSTMASTER, 0, NULL, NULL);
+#endif
+
+	defined = true;
+
+	if (!process_shared_preload_libraries_in_progress
+		|| pl_workers == NULL || pl_workers[0] == '\0')
+		return;
+
+#if PG_VERSION_NUM >= 90300
+	for (i = 0; worker_entry(i, &database, &function); ++i)
+	{
+		BackgroundWorker worker;
+#if PG_VERSION_NUM < 90400
+		char name[NAMEDATALEN * 2];
+#endif
+
+		if (database == NULL)
+		{
+			ereport(WARNING,(
+				errmsg("ignoring malformed python.workers entry %d", i),
+				errhint("Entries are written as database:schema.function.")
+			));
+			continue;
+		}
+
+		memset(&worker, 0, sizeof(worker));
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+		worker.bgw_restart_time = WORKER_RESTART_INTERVAL;
+		worker.bgw_main_arg = Int32GetDatum(i);
+#if PG_VERSION_NUM >= 90400
+		snprintf(worker.bgw_name, BGW_MAXLEN, "python %s", function);
+		snprintf(worker.bgw_library_name, BGW_MAXLEN, "python");
+		snprintf(worker.bgw_function_name, BGW_MAXLEN, "pl_worker_main");
+#else
+		/* copied by RegisterBackgroundWorker */
+		snprintf(name, sizeof(name), "python %s", function);
+		worker.bgw_name = name;
+		worker.bgw_main = pl_worker_main;
+#endif
+
+		RegisterBackgroundWorker(&worker);
+
+		pfree(database);
+		pfree(function);
+	}
+#else
+	ereport(WARNING,(
+		errmsg("python.workers requires PostgreSQL 9.3 or later")
+	));
+#endif
+}
+
+/*
+ * Postgres.MessageQueue; one end of a dynamic worker's queues.
+ */
+struct PyPgMessageQueue {
+	PyObject_HEAD
+	long mq_pid;				/* of the other end */
+#if PG_VERSION_NUM >= 90500
+	dsm_segment *mq_segment;	/* detached on dealloc; NULL in the worker */
+	BackgroundWorkerHandle *mq_worker;
+	shm_mq_handle *mq_send;
+	shm_mq_handle *mq_receive;
+#endif
+};
+#define MQ(SELF) ((struct PyPgMessageQueue *) (SELF))
+
+static PyObj
+mq_send(PyObj self, PyObj args, PyObj kw)
+{
+#if PG_VERSION_NUM >= 90500
+	static char *words[] = {"data", "nowait", NULL};
+	Py_buffer data;
+	PyObj nowait_ob = Py_False;
+	int nowait;
+	volatile shm_mq_result r = SHM_MQ_SUCCESS;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "y*|O:send", words,
+			&data, &nowait_ob))
+		return(NULL);
+
+	nowait = PyObject_IsTrue(nowait_ob);
+	if (nowait == -1)
+	{
+		PyBuffer_Release(&data);
+		return(NULL);
+	}
+
+	PG_TRY();
+	{
+#if PG_VERSION_NUM >= 150000
+		r = shm_mq_send(MQ(self)->mq_send, data.len, data.buf, nowait, true);
+#else
+		r = shm_mq_send(MQ(self)->mq_send, data.len, data.buf, nowait);
+#endif
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	PyBuffer_Release(&data);
+
+	if (PyErr_Occurred())
+		return(NULL);
+
+	switch (r)
+	{
+		case SHM_MQ_SUCCESS:
+			Py_INCREF(Py_True);
+			return(Py_True);
+
+		case SHM_MQ_WOULD_BLOCK:
+			Py_INCREF(Py_False);
+			return(Py_False);
+
+		default:
+			PyErr_SetString(PyExc_EOFError, "the other end of the queue has detached");
+			return(NULL);
+	}
+#else
+	PyErr_SetString(PyExc_NotImplementedError,
+		"message queues require PostgreSQL 9.5 or later");
+	return(NULL);
+#endif
+}
+
+static PyObj
+mq_receive(PyObj self, PyObj args, PyObj kw)
+{
+#if PG_VERSION_NUM >= 90500
+	static char *words[] = {"nowait", NULL};
+	PyObj nowait_ob = Py_False;
+	int nowait;
+	volatile shm_mq_result r = SHM_MQ_SUCCESS;
+	PyObj rob = NULL;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|O:receive", words, &nowait_ob))
+		return(NULL);
+
+	nowait = PyObject_IsTrue(nowait_ob);
+	if (nowait == -1)
+		return(NULL);
+
+	PG_TRY();
+	{
+		Size nbytes;
+		void *data;
+
+		r = shm_mq_receive(MQ(self)->mq_receive, &nbytes, &data, nowait);
+
+		/*
+		 * The data is only valid until the next receive.
+		 */
+		if (r == SHM_MQ_SUCCESS)
+			rob = PyBytes_FromStringAndSize(data, nbytes);
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	if (PyErr_Occurred())
+	{
+		Py_XDECREF(rob);
+		return(NULL);
+	}
+
+	switch (r)
+	{
+		case SHM_MQ_SUCCESS:
+			return(rob);
+
+		case SHM_MQ_WOULD_BLOCK:
+			Py_INCREF(Py_None);
+			return(Py_None);
+
+		default:
+			PyErr_SetString(PyExc_EOFError, "the other end of the queue has detached");
+			return(NULL);
+	}
+#else
+	PyErr_SetString(PyExc_NotImplementedError,
+		"message queues require PostgreSQL 9.5 or later");
+	return(NULL);
+#endif
+}
+
+static PyMethodDef PyPgMessageQueue_Methods[] = {
+	{"send", (PyCFunction) mq_send, METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("send bytes to the other end; False if nowait and the queue is full")},
+	{"receive", (PyCFunction) mq_receive, METH_VARARGS|METH_KEYWORDS,
+		PyDoc_STR("receive bytes from the other end; None if nowait and the queue is empty")},
+	{NULL}
+};
+
+static PyMemberDef PyPgMessageQueue_Members[] = {
+	{"pid", T_LONG, offsetof(struct PyPgMessageQueue, mq_pid), READONLY,
+		PyDoc_STR("process id of the other end of the queue")},
+	{NULL}
+};
+
+static void
+mq_dealloc(PyObj self)
+{
+#if PG_VERSION_NUM >= 90500
+	/*
+	 * The worker's queue is never freed, so this is the starting backend's
+	 * end. Detaching the segment detaches the queues, and the worker will see
+	 * that on its next send or receive.
+	 */
+	if (MQ(self)->mq_segment != NULL)
+	{
+#if PG_VERSION_NUM >= 100000
+		if (MQ(self)->mq_send != NULL)
+			shm_mq_detach(MQ(self)->mq_send);
+		if (MQ(self)->mq_receive != NULL)
+			shm_mq_detach(MQ(self)->mq_receive);
+#else
+		if (MQ(self)->mq_send != NULL)
+			pfree(MQ(self)->mq_send);
+		if (MQ(self)->mq_receive != NULL)
+			pfree(MQ(self)->mq_receive);
+#endif
+		dsm_detach(MQ(self)->mq_segment);
+
+		if (MQ(self)->mq_worker != NULL)
+			pfree(MQ(self)->mq_worker);
+	}
+#endif
+
+	Py_TYPE(self)->tp_free(self);
+}
+
+static const char PyPgMessageQueue_Doc[] =
+	"A queue of byte messages between a dynamic worker and the backend that started it";
+
+PyTypeObject PyPgMessageQueue_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"Postgres.MessageQueue",			/* tp_name */
+	sizeof(struct PyPgMessageQueue),	/* tp_basicsize */
+	0,									/* tp_itemsize */
+	mq_dealloc,							/* tp_dealloc */
+	NULL,								/* tp_print */
+	NULL,								/* tp_getattr */
+	NULL,								/* tp_setattr */
+	NULL,								/* tp_compare */
+	NULL,								/* tp_repr */
+	NULL,								/* tp_as_number */
+	NULL,								/* tp_as_sequence */
+	NULL,								/* tp_as_mapping */
+	NULL,								/* tp_hash */
+	NULL,								/* tp_call */
+	NULL,								/* tp_str */
+	NULL,								/* tp_getattro */
+	NULL,								/* tp_setattro */
+	NULL,								/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT,					/* tp_flags */
+	PyPgMessageQueue_Doc,				/* tp_doc */
+	NULL,								/* tp_traverse */
+	NULL,								/* tp_clear */
+	NULL,								/* tp_richcompare */
+	0,									/* tp_weaklistoffset */
+	NULL,								/* tp_iter */
+	NULL,								/* tp_iternext */
+	PyPgMessageQueue_Methods,			/* tp_methods */
+	PyPgMessageQueue_Members,			/* tp_members */
+	NULL,								/* tp_getset */
+	NULL,								/* tp_base */
+	NULL,								/* tp_dict */
+	NULL,								/* tp_descr_get */
+	NULL,								/* tp_descr_set */
+	0,									/* tp_dictoffset */
+	NULL,								/* tp_init */
+	NULL,								/* tp_alloc */
+	NULL,								/* tp_new */
+};
+
+PyObj
+worker_start(PyObj function, Py_ssize_t queue_size)
+{
+#if PG_VERSION_NUM >= 90500
+	PyObj rob;
+
+	if (DB_IS_NOT_READY())
+		return(NULL);
+
+	if (queue_size < (Py_ssize_t) shm_mq_minimum_size)
+	{
+		PyErr_Format(PyExc_ValueError,
+			"queue_size must be at least %zd bytes", (Py_ssize_t) shm_mq_minimum_size);
+		return(NULL);
+	}
+
+	rob = PyPgMessageQueue_Type.tp_alloc(&PyPgMessageQueue_Type, 0);
+	if (rob == NULL)
+		return(NULL);
+
+	Py_INCREF(function);
+	PyObject_StrBytes(&function);
+	if (function == NULL)
+	{
+		Py_DECREF(rob);
+		return(NULL);
+	}
+
+	/*
+	 * The segment and handles are set on the object as they are created, so
+	 * mq_dealloc releases them when the worker cannot be started.
+	 */
+	PG_TRY();
+	{
+		BackgroundWorker worker;
+		BgwHandleStatus status;
+		struct worker_extra extra;
+		MemoryContext former;
+		Oid fn_oid;
+		pid_t started;
+		Size size = MAXALIGN(queue_size);
+		char *address;
+		shm_mq *to_worker, *from_worker;
+
+		if (!superuser())
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				errmsg("must be superuser to start background workers")
+			));
+		}
+
+		fn_oid = worker_function(PyBytes_AS_STRING(function));
+
+		/*
+		 * The mapping outlives the transaction; the object owns it.
+		 */
+		MQ(rob)->mq_segment = dsm_create(size * 2, 0);
+		dsm_pin_mapping(MQ(rob)->mq_segment);
+
+		address = dsm_segment_address(MQ(rob)->mq_segment);
+		to_worker = shm_mq_create(address, size);
+		from_worker = shm_mq_create(address + size, size);
+		shm_mq_set_sender(to_worker, MyProc);
+		shm_mq_set_receiver(from_worker, MyProc);
+
+		extra.we_database = MyDatabaseId;
+		extra.we_role = GetUserId();
+		extra.we_segment = dsm_segment_handle(MQ(rob)->mq_segment);
+		extra.we_queue_size = size;
+
+		memset(&worker, 0, sizeof(worker));
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+		worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+		worker.bgw_main_arg = ObjectIdGetDatum(fn_oid);
+		worker.bgw_notify_pid = MyProcPid;
+		memcpy(worker.bgw_extra, &extra, sizeof(extra));
+		snprintf(worker.bgw_name, BGW_MAXLEN, "python %s", PyBytes_AS_STRING(function));
+		snprintf(worker.bgw_library_name, BGW_MAXLEN, "python");
+		snprintf(worker.bgw_function_name, BGW_MAXLEN, "pl_dynamic_worker_main");
+
+		/*
+		 * Given the worker's handle, the queues report a worker that exits
+		 * before attaching as detached instead of waiting for it.
+		 */
+		former = MemoryContextSwitchTo(TopMemoryContext);
+		if (RegisterDynamicBackgroundWorker(&worker, &(MQ(rob)->mq_worker)))
+		{
+			MQ(rob)->mq_send = shm_mq_attach(to_worker,
+				MQ(rob)->mq_segment, MQ(rob)->mq_worker);
+			MQ(rob)->mq_receive = shm_mq_attach(from_worker,
+				MQ(rob)->mq_segment, MQ(rob)->mq_worker);
+		}
+		MemoryContextSwitchTo(former);
+
+		if (MQ(rob)->mq_worker == NULL)
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				errmsg("could not register background worker"),
+				errhint("Consider increasing max_worker_processes.")
+			));
+		}
+
+		status = WaitForBackgroundWorkerStartup(MQ(rob)->mq_worker, &started);
+		if (status == BGWH_POSTMASTER_DIED)
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				errmsg("cannot start background workers without postmaster")
+			));
+		}
+		else if (status != BGWH_STARTED)
+		{
+			ereport(ERROR,(
+				errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+				errmsg("could not start background worker"),
+				errhint("More details may be available in the server log.")
+			));
+		}
+
+		MQ(rob)->mq_pid = (long) started;
+	}
+	PG_CATCH();
+	{
+		PyErr_SetPgError(false);
+	}
+	PG_END_TRY();
+
+	Py_DECREF(function);
+
+	if (PyErr_Occurred())
+	{
+		Py_DECREF(rob);
+		return(NULL);
+	}
+
+	return(rob);
+#else
+	PyErr_SetString(PyExc_NotImplementedError,
+		"dynamic background workers require PostgreSQL 9.5 or later");
+	return(NULL);
+#endif
+}
+
+PyObj
+worker_queue(void)
+{
+#if PG_VERSION_NUM >= 90500
+	if (worker_segment == NULL)
+	{
+		Py_INCREF(Py_None);
+		return(Py_None);
+	}
+
+	/*
+	 * Kept for the life of the process, so the worker's ends are never
+	 * detached by mq_dealloc.
+	 */
+	if (worker_queue_ob == NULL)
+	{
+		worker_queue_ob = PyPgMessageQueue_Type.tp_alloc(&PyPgMessageQueue_Type, 0);
+		if (worker_queue_ob == NULL)
+			return(NULL);
+
+		MQ(worker_queue_ob)->mq_pid = (long) MyBgworkerEntry->bgw_notify_pid;
+		MQ(worker_queue_ob)->mq_send = worker_send;
+		MQ(worker_queue_ob)->mq_receive = worker_receive;
+	}
+
+	Py_INCREF(worker_queue_ob);
+	return(worker_queue_ob);
+#else
+	Py_INCREF(Py_None);
+	return(Py_None);
+#endif
+}
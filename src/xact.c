@@ -36,6 +36,29 @@ xact_enter(PyObj self)
 		return(NULL);
 	}
 
+	if (PyPgTransaction_IsDeferred(self))
+	{
+		/*
+		 * Check the state without starting the enclosing deferred ISTs.
+		 */
+		if (ext_state == xact_failed)
+		{
+			PyErr_SetInFailedTransaction();
+			return(NULL);
+		}
+		if (ext_state != ext_ready)
+		{
+			PyErr_SetDatabaseAccessDenied();
+			return(NULL);
+		}
+
+		PyPgTransaction_SetId(self, ist_defer());
+		PyPgTransaction_SetState(self, ist_deferred);
+
+		Py_INCREF(Py_None);
+		return(Py_None);
+	}
+
 	if (DB_IS_NOT_READY())
 		return(NULL);
 
@@ -67,6 +90,29 @@ xact_exit(PyObj self, PyObj args)
 
 	state = PyPgTransaction_GetState(self);
 
+	if (state == ist_deferred)
+	{
+		if (xid > ist_count)
+		{
+			/*
+			 * The block did not access the database; no subtransaction to
+			 * release.
+			 */
+			if (!ist_forget(xid, typ == Py_None))
+			{
+				PyPgTransaction_SetState(self, ist_aborted);
+				return(NULL);
+			}
+			PyPgTransaction_SetState(self, typ == Py_None ? ist_committed : ist_aborted);
+
+			Py_INCREF(Py_None);
+			return(Py_None);
+		}
+
+		/* Started by a database access in the block. */
+		state = ist_open;
+	}
+
 	if (typ == Py_None)
 	{
 		/* Attempt commit */
@@ -109,11 +155,27 @@ static PyMethodDef PyPgTransaction_Methods[] = {
 static PyObj
 xact_new(PyTypeObject *subtype, PyObj args, PyObj kw)
 {
-	static char *words[] = {NULL};
+	static char *words[] = {"deferred", NULL};
+	PyObj deferred = NULL;
+	PyObj rob;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kw, "", words))
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|O:Transaction", words, &deferred))
 		return(NULL);
-	return(PyPgTransaction_NEW((PyTypeObject *) subtype));
+
+	rob = PyPgTransaction_NEW((PyTypeObject *) subtype);
+	if (rob != NULL && deferred != NULL)
+	{
+		int r = PyObject_IsTrue(deferred);
+
+		if (r == -1)
+		{
+			Py_DECREF(rob);
+			return(NULL);
+		}
+		PyPgTransaction(rob)->deferred = (r == 1);
+	}
+
+	return(rob);
 }
 
 const char PyPgTransaction_Doc[] = "Postgres Internal Subtransaction interface";
@@ -168,6 +230,7 @@ PyPgTransaction_NEW(PyTypeObject *subtype)
 	{
 		PyPgTransaction_SetState(rob, ist_new);
 		PyPgTransaction_SetId(rob, 0);
+		PyPgTransaction(rob)->deferred = false;
 	}
 
 	return(rob);
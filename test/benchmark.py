@@ -0,0 +1,334 @@
+##
+# Micro-benchmarks for the handler's hot paths.
+#
+# Like test_interrupt.py, this runs against a temporary cluster created by
+# postgresql.temporal.pg_tmp. Results are written as JSON, one object per
+# line, so they can be collected and compared across builds:
+#
+#  python3 test/benchmark.py [-s SCALE] [-r REPEAT] [-k SUBSTRING] [-o FILE]
+#
+# Each result has the benchmark's name, the number of operations performed
+# per run, and the timings, in seconds, of every run. "per_op" is derived from
+# the fastest run.
+##
+import sys
+import time
+import json
+import platform
+import argparse
+from postgresql.temporal import pg_tmp
+
+mklang_90 = """
+CREATE SCHEMA __python__;
+SET search_path = __python__;
+
+CREATE FUNCTION
+ "handler"()
+RETURNS LANGUAGE_HANDLER LANGUAGE C AS 'python', 'pl_handler';
+
+CREATE FUNCTION
+ "validator"(oid)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_validator';
+
+CREATE FUNCTION
+ "inline"(INTERNAL)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_inline';
+
+CREATE LANGUAGE python HANDLER "handler" INLINE "inline" VALIDATOR "validator";
+"""
+
+mklang_83 = """
+CREATE SCHEMA __python__;
+SET search_path = __python__;
+
+CREATE FUNCTION
+ "handler"()
+RETURNS LANGUAGE_HANDLER LANGUAGE C AS 'python', 'pl_handler';
+
+CREATE FUNCTION
+ "validator"(oid)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_validator';
+
+CREATE LANGUAGE python HANDLER "handler" VALIDATOR "validator";
+"""
+
+##
+# Types used by the argument and result conversion benchmarks.
+# (type, expression of "i" producing a value of the type)
+conversion_types = [
+	('int2', '(i % 30000)::int2'),
+	('int4', 'i::int4'),
+	('int8', 'i::int8'),
+	('float4', 'i::float4'),
+	('float8', 'i::float8'),
+	('numeric', 'i::numeric'),
+	('bool', '(i % 2 = 0)'),
+	('text', "'text value ' || i::text"),
+	('varchar', "('varchar value ' || i::text)::varchar"),
+	('bytea', "decode(md5(i::text), 'hex')"),
+	('date', "'2000-01-01'::date + (i % 10000)"),
+	('timestamptz', "'2000-01-01'::timestamptz + (i || ' seconds')::interval"),
+]
+
+functions = """
+CREATE FUNCTION public.bench_noop() RETURNS int LANGUAGE python AS
+$$
+def main():
+	return 1
+$$;
+
+CREATE FUNCTION public.bench_srf(int) RETURNS SETOF int LANGUAGE python AS
+$$
+def main(n):
+	return range(n)
+$$;
+
+CREATE FUNCTION public.bench_trigger() RETURNS TRIGGER LANGUAGE python AS
+$$
+def before_insert(td, new):
+	pass
+$$;
+
+CREATE TABLE public.bench_table (i int);
+CREATE TABLE public.bench_table_triggered (i int);
+CREATE TRIGGER bench_before_insert BEFORE INSERT ON public.bench_table_triggered
+FOR EACH ROW EXECUTE PROCEDURE public.bench_trigger();
+
+CREATE FUNCTION public.bench_rows(int) RETURNS int8 LANGUAGE python AS
+$$
+s = prepare('SELECT i FROM generate_series(1, $1) AS g(i)')
+def main(n):
+	c = 0
+	for row in s.rows(n):
+		c += 1
+	return c
+$$;
+
+CREATE FUNCTION public.bench_chunks(int) RETURNS int8 LANGUAGE python AS
+$$
+s = prepare('SELECT i FROM generate_series(1, $1) AS g(i)')
+def main(n):
+	c = 0
+	for chunk in s.chunks(n):
+		c += len(chunk)
+	return c
+$$;
+
+CREATE FUNCTION public.bench_column(int) RETURNS int8 LANGUAGE python AS
+$$
+s = prepare('SELECT i FROM generate_series(1, $1) AS g(i)')
+def main(n):
+	c = 0
+	for x in s.column(n):
+		c += 1
+	return c
+$$;
+
+CREATE FUNCTION public.bench_load_rows(int) RETURNS int8 LANGUAGE python AS
+$$
+s = prepare('INSERT INTO public.bench_table VALUES ($1)')
+def main(n):
+	s.load_rows((i,) for i in range(n))
+	return n
+$$;
+
+CREATE FUNCTION public.bench_array_in(int8[]) RETURNS int8 LANGUAGE python AS
+$$
+def main(a):
+	return len(a.tolist()) if hasattr(a, 'tolist') else len(list(a))
+$$;
+
+CREATE FUNCTION public.bench_array_out_int8(int) RETURNS int8[] LANGUAGE python AS
+$$
+def main(n):
+	return list(range(n))
+$$;
+
+CREATE FUNCTION public.bench_array_out_text(int) RETURNS text[] LANGUAGE python AS
+$$
+def main(n):
+	return ['element ' + str(i) for i in range(n)]
+$$;
+
+CREATE TYPE public.bench_record AS (i int, t text, f float8);
+
+CREATE FUNCTION public.bench_record_in(public.bench_record) RETURNS int LANGUAGE python AS
+$$
+def main(r):
+	return r[0]
+$$;
+
+CREATE FUNCTION public.bench_record_out(int) RETURNS public.bench_record LANGUAGE python AS
+$$
+def main(i):
+	return (i, 'text', 1.5)
+$$;
+
+CREATE FUNCTION public.bench_subxact(int) RETURNS int LANGUAGE python AS
+$$
+def main(n):
+	for i in range(n):
+		with xact():
+			pass
+	return n
+$$;
+"""
+
+def conversion_functions():
+	for typ, expr in conversion_types:
+		yield """
+CREATE FUNCTION public.bench_identity_%s(%s) RETURNS %s LANGUAGE python AS
+$$
+def main(x):
+	return x
+$$;
+""" %(typ, typ, typ)
+
+		yield """
+CREATE FUNCTION public.bench_native_%s(%s) RETURNS %s LANGUAGE python AS
+$$
+import Postgres
+def main(x):
+	return Postgres.convert_postgres_objects((x,))[0]
+$$;
+""" %(typ, typ, typ)
+
+def query(sql):
+	"""
+	Benchmark body that executes the given query once.
+	"""
+	def run(n, sql = sql):
+		prepare(sql).first(n)
+	return run
+
+def transactions(sql):
+	"""
+	Benchmark body that executes the given query in `n` separate transactions.
+	"""
+	def run(n, sql = sql):
+		ps = prepare(sql)
+		for i in range(n):
+			ps.first()
+	return run
+
+def benchmarks(scale):
+	"""
+	Generate (name, operations, setup, body) tuples.
+	"""
+	n = 10000 * scale
+	series = 'SELECT count(%s) FROM generate_series(1, $1::int) AS g(i)'
+
+	yield ('scalar.call', n, None, query(series % ('public.bench_noop()',)))
+
+	for typ, expr in conversion_types:
+		yield (
+			'conversion.identity.' + typ, n, None,
+			query(series % ('public.bench_identity_%s(%s)' %(typ, expr),))
+		)
+		yield (
+			'conversion.native.' + typ, n, None,
+			query(series % ('public.bench_native_%s(%s)' %(typ, expr),))
+		)
+
+	yield ('srf.materialize', n * 10, None,
+		query('SELECT count(*) FROM public.bench_srf($1::int)'))
+	yield ('srf.value_per_call', n * 10, None,
+		query('SELECT count(public.bench_srf($1::int))'))
+
+	truncate = lambda: sqlexec('TRUNCATE public.bench_table, public.bench_table_triggered')
+	yield ('trigger.none', n, truncate,
+		query('INSERT INTO public.bench_table SELECT generate_series(1, $1::int)'))
+	yield ('trigger.before_row', n, truncate,
+		query('INSERT INTO public.bench_table_triggered SELECT generate_series(1, $1::int)'))
+
+	yield ('statement.rows', n * 10, None, query('SELECT public.bench_rows($1::int)'))
+	yield ('statement.chunks', n * 10, None, query('SELECT public.bench_chunks($1::int)'))
+	yield ('statement.column', n * 10, None, query('SELECT public.bench_column($1::int)'))
+	yield ('statement.load_rows', n, truncate, query('SELECT public.bench_load_rows($1::int)'))
+
+	yield ('array.in.int8', n * 10, None,
+		query('SELECT public.bench_array_in(array(SELECT generate_series(1, $1::int8)))'))
+	yield ('array.out.int8', n * 10, None,
+		query('SELECT array_length(public.bench_array_out_int8($1::int), 1)'))
+	yield ('array.out.text', n * 10, None,
+		query('SELECT array_length(public.bench_array_out_text($1::int), 1)'))
+
+	yield ('record.in', n, None,
+		query(series % ("public.bench_record_in(ROW(i, 'text', 1.5)::public.bench_record)",)))
+	yield ('record.out', n, None,
+		query(series % ('public.bench_record_out(i)',)))
+
+	yield ('xact.subtransaction', n, None, query('SELECT public.bench_subxact($1::int)'))
+	# Transaction boundaries; baseline without the PL, then with it.
+	yield ('xact.boundary.baseline', n // 10, None, transactions('SELECT 1'))
+	yield ('xact.boundary.call', n // 10, None, transactions('SELECT public.bench_noop()'))
+
+def run(args, output):
+	info = {
+		'benchmark': '__environment__',
+		'server_version': db.version,
+		'python': sys.version.split()[0],
+		'platform': platform.platform(),
+		'scale': args.scale,
+		'repeat': args.repeat,
+	}
+	output.write(json.dumps(info, sort_keys = True) + '\n')
+
+	for name, ops, setup, body in benchmarks(args.scale):
+		if args.filter and not any(x in name for x in args.filter):
+			continue
+
+		# Warm up: load the function modules and cache the plans.
+		if setup is not None:
+			setup()
+		body(min(ops, 100))
+
+		timings = []
+		for i in range(args.repeat):
+			if setup is not None:
+				setup()
+			start = time.time()
+			body(ops)
+			timings.append(time.time() - start)
+
+		output.write(json.dumps({
+			'benchmark': name,
+			'operations': ops,
+			'timings': timings,
+			'per_op': min(timings) / ops,
+		}, sort_keys = True) + '\n')
+		output.flush()
+
+def main(argv):
+	p = argparse.ArgumentParser(description = 'run the handler benchmarks')
+	p.add_argument('-s', '--scale', type = int, default = 1,
+		help = 'multiply the number of operations performed by each benchmark')
+	p.add_argument('-r', '--repeat', type = int, default = 5,
+		help = 'number of timed runs of each benchmark')
+	p.add_argument('-k', '--filter', action = 'append', default = [],
+		help = 'only run benchmarks whose name contains the given string')
+	p.add_argument('-o', '--output', default = None,
+		help = 'write the results to the given file instead of stdout')
+	args = p.parse_args(argv)
+
+	output = sys.stdout
+	if args.output is not None:
+		output = open(args.output, 'w')
+
+	try:
+		with pg_tmp:
+			if db.version_info[:2] < (8,5):
+				sqlexec(mklang_83)
+			else:
+				sqlexec(mklang_90)
+			sqlexec("SET search_path = public;")
+			sqlexec(functions)
+			for x in conversion_functions():
+				sqlexec(x)
+			run(args, output)
+	finally:
+		if output is not sys.stdout:
+			output.close()
+
+if __name__ == '__main__':
+	main(sys.argv[1:])
@@ -421,3 +421,66 @@ SELECT py_array_get_element(ARRAY[[[[[['deep'],['deeper']]]]]]::text[], ARRAY[0,
 SELECT py_array_get_element(ARRAY[[[[[['deep']]]]]]::text[], ARRAY[0,0,0,0,0,1]);
 SELECT py_array_get_element(ARRAY[[[[[['deep']]]]]]::text[], ARRAY[0,0,0,0,0]);
 
+
+-- tolist() and iter_elements()
+CREATE OR REPLACE FUNCTION py_array_tolist(anyarray) RETURNS text LANGUAGE python AS
+$python$
+def main(arr):
+	return repr(arr.tolist()) + ' ' + repr(list(arr.iter_elements(native = True)))
+$python$;
+
+SELECT py_array_tolist('{}'::int[]);
+SELECT py_array_tolist(ARRAY[[1,2],[3,NULL]]::int8[]);
+SELECT py_array_tolist(ARRAY[[NULL,'val'],['key2','val2']]::text[]);
+SELECT py_array_tolist(ARRAY[[[1.5]],[[NULL]]]::float8[]);
+SELECT py_array_tolist(ARRAY[true,NULL,false]);
+
+-- sub-arrays of multi-dimensional arrays
+CREATE OR REPLACE FUNCTION py_array_rows(anyarray) RETURNS text LANGUAGE python AS
+$python$
+def main(arr):
+	return ' '.join(str(x) for x in arr)
+$python$;
+
+SELECT py_array_rows(ARRAY[[1,2],[3,4],[5,6]]::int4[]);
+SELECT py_array_rows(ARRAY[[NULL,'val'],['key2','val2']]::text[]);
+SELECT py_array_rows('[2:3][3:4]={{a,b},{c,NULL}}'::text[]);
+
+-- Elements of the common types are converted directly; anything else takes
+-- the generic path, which applies typinput's semantics.
+CREATE OR REPLACE FUNCTION check_array_elements() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+from Postgres.types import int2, int4, float8, text, bpchar, name
+
+class strsub(str):
+	pass
+
+def main():
+	assert int4.Array([1, None, 3]).tolist() == [1, None, 3]
+	assert float8.Array([1.5, 2.0]).tolist() == [1.5, 2.0]
+	# strings given to numeric types use typinput
+	assert int4.Array(['1', '2']).tolist() == [1, 2]
+	try:
+		with xact():
+			int2.Array([70000])
+	except Exception:
+		pass
+	else:
+		assert False, "out of range int2 was accepted"
+
+	assert text.Array(['a', strsub('b'), None]).tolist() == ['a', 'b', None]
+	# typinput truncates at a NUL
+	assert text.Array(['a\x00b']).tolist() == ['a']
+	# bpchar elements without a typmod are not padded
+	assert bpchar.Array(['ab ', 'c']).tolist() == ['ab ', 'c']
+	assert name.Array(['x' * 70]).tolist() == ['x' * 63]
+
+	# iter_elements() converts elements as tolist() does by default
+	a = int4.Array([[1, 2], [3, None]])
+	assert list(a.iter_elements()) == [1, 2, 3, None]
+	assert type(a.iter_elements()) is Postgres.ArrayIter
+	assert [type(x) for x in a.iter_elements(native = False)][:3] == [int4] * 3
+	return 'success'
+$python$;
+SELECT check_array_elements();
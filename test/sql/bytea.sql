@@ -93,3 +93,28 @@ def main():
 $python$;
 
 SELECT test_bytea_slicing();
+
+CREATE TABLE toasted_bytea (b bytea);
+ALTER TABLE toasted_bytea ALTER COLUMN b SET STORAGE EXTERNAL;
+INSERT INTO toasted_bytea SELECT decode(repeat('0123456789abcdef', 16384), 'hex');
+
+CREATE OR REPLACE FUNCTION test_bytea_toasted(b bytea) RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+def main(b):
+	st = Postgres.stats()
+	assert st['toast_deferred'] > 0
+	# slices only fetch the necessary chunks
+	assert len(b) == 131072
+	assert b[:4] == b'\x01\x23\x45\x67'
+	assert b[-2:] == b'\xcd\xef'
+	assert b[16] == b'\x01'
+	assert Postgres.stats()['toast_detoasted'] == st['toast_detoasted']
+	# the whole buffer is requested
+	assert bytes(b)[8:16] == b'\x01\x23\x45\x67\x89\xab\xcd\xef'
+	assert Postgres.stats()['toast_detoasted'] == st['toast_detoasted'] + 1
+	return 'success'
+$python$;
+
+SELECT test_bytea_toasted(b) FROM toasted_bytea;
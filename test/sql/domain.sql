@@ -181,3 +181,59 @@ $python$;
 -- check domain values.
 SELECT check_on_srf();
 SELECT * FROM check_on_srf();
+
+-- check_all() validates a set of values at once, and constraints added
+-- after the domain was loaded are still applied.
+CREATE DOMAIN i6 AS int4;
+CREATE OR REPLACE FUNCTION check_all_i6(int4[]) RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+rt = Postgres.Type(Postgres.CONST['REGTYPEOID'])
+i6 = Postgres.Type(rt('i6'))
+
+def main(values):
+	try:
+		with xact():
+			i6.check_all([None if x is None else i6(x) for x in values])
+		return 'valid'
+	except Postgres.Exception as e:
+		return e.code + ': ' + e.message
+$python$;
+
+SELECT check_all_i6(ARRAY[1, 2, NULL]);
+ALTER DOMAIN i6 ADD CONSTRAINT i6_positive CHECK (VALUE > 0);
+SELECT check_all_i6(ARRAY[1, -2, NULL]);
+
+-- A CHECK constraint that checks a smaller value of the same domain while
+-- the outer check is in progress.
+CREATE OR REPLACE FUNCTION countdown_check(int4) RETURNS bool LANGUAGE python AS
+$python$
+import Postgres
+
+def main(i):
+	if i > 0:
+		rt = Postgres.Type(Postgres.CONST['REGTYPEOID'])
+		Postgres.Type(rt('countdown'))(i - 1)
+	return i >= 0
+$python$;
+CREATE DOMAIN countdown AS int4
+	CONSTRAINT countdown_check CHECK (countdown_check(VALUE))
+	CONSTRAINT countdown_limit CHECK (VALUE < 10);
+
+CREATE OR REPLACE FUNCTION check_countdown(int4) RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+rt = Postgres.Type(Postgres.CONST['REGTYPEOID'])
+countdown = Postgres.Type(rt('countdown'))
+
+def main(i):
+	try:
+		with xact():
+			return str(countdown(i))
+	except Postgres.Exception as e:
+		return e.code + ': ' + e.message
+$python$;
+
+SELECT check_countdown(3);
+SELECT check_countdown(12);
+SELECT check_countdown(3);
@@ -16,3 +16,38 @@ def main():
 	sys.argv
 $$;
 SELECT sys_no_argv();
+
+-- Postgres.shared without the region; the extension is not preloaded here
+CREATE OR REPLACE FUNCTION shared_absent() RETURNS text LANGUAGE python AS
+$$
+import Postgres
+
+def main():
+	shared = Postgres.shared
+	try:
+		shared['absent']
+	except KeyError:
+		pass
+	else:
+		assert False, "KeyError not raised"
+	assert shared.get('absent') is None
+	assert shared.get('absent', b'x') == b'x'
+	assert 'absent' not in shared
+	assert len(shared) == 0
+	assert list(shared.keys()) == []
+	assert list(shared) == []
+	try:
+		shared.version('absent')
+	except KeyError:
+		pass
+	else:
+		assert False, "KeyError not raised"
+	try:
+		shared.publish('absent', b'data')
+	except RuntimeError as err:
+		assert 'shared_preload_libraries' in str(err)
+	else:
+		assert False, "RuntimeError not raised"
+	return 'success'
+$$;
+SELECT shared_absent();
@@ -371,3 +371,42 @@ def main():
 	raise TypeError
 $python$;
 SELECT check_linecache_clear();
+
+-- deferred tracebacks are expanded when the error is reported
+CREATE OR REPLACE FUNCTION raise_for_plpgsql() RETURNS int LANGUAGE python AS
+$python$
+def main():
+	raise ValueError("caught by PL/pgSQL")
+$python$;
+SELECT raise_for_plpgsql();
+
+-- PL/pgSQL reads the context of the errors that it catches directly, so the
+-- traceback must not be deferred within its EXCEPTION blocks.
+CREATE OR REPLACE FUNCTION plpgsql_catch_context() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+# GET STACKED DIAGNOSTICS is available on 9.2 and later.
+catch = """
+CREATE OR REPLACE FUNCTION catch_python_error() RETURNS text LANGUAGE plpgsql AS $$
+DECLARE
+	ctx text;
+BEGIN
+	PERFORM raise_for_plpgsql();
+	RETURN 'not caught';
+EXCEPTION WHEN OTHERS THEN
+	GET STACKED DIAGNOSTICS ctx = PG_EXCEPTION_CONTEXT;
+	RETURN ctx;
+END;
+$$;
+"""
+
+def main():
+	if Postgres.version_info[:2] >= (9, 2):
+		Postgres.execute(catch)
+		ctx = str(Postgres.eval('catch_python_error()'))
+		assert '<deferred' not in ctx, ctx
+		assert 'ValueError: caught by PL/pgSQL' in ctx, ctx
+	return 'formatted'
+$python$;
+SELECT plpgsql_catch_context();
@@ -48,3 +48,83 @@ def main(i, t):
 $python$;
 SELECT "need""quote".funcname(1,'t');
 -- The fun part is where the original nspname is no longer up-to-date.
+
+-- Handler statistics
+CREATE OR REPLACE FUNCTION count_me() RETURNS int LANGUAGE python AS
+$python$
+def main():
+	return 1
+$python$;
+CREATE OR REPLACE FUNCTION count_calls(int8) RETURNS int8 LANGUAGE python AS
+$python$
+import Postgres
+def main(fn):
+	return Postgres.stats()['functions'].get(int(fn), {}).get('calls', 0)
+$python$;
+SELECT count_me() FROM generate_series(1, 3);
+SELECT count_calls('count_me()'::regprocedure::oid::int8);
+CREATE OR REPLACE FUNCTION reset_stats() RETURNS VOID LANGUAGE python AS
+$python$
+import Postgres
+def main():
+	Postgres.reset_stats()
+$python$;
+SELECT reset_stats();
+SELECT count_calls('count_me()'::regprocedure::oid::int8);
+CREATE OR REPLACE FUNCTION timed(int8) RETURNS bool LANGUAGE python AS
+$python$
+import Postgres
+def main(fn):
+	return Postgres.stats()['functions'][int(fn)]['total'] > 0
+$python$;
+SELECT count_me();
+SELECT timed('count_me()'::regprocedure::oid::int8);
+SET python.track_functions = on;
+SELECT count_me();
+SELECT timed('count_me()'::regprocedure::oid::int8);
+RESET python.track_functions;
+
+-- aggregates with Python transition state
+CREATE FUNCTION median_step(internal, float8) RETURNS internal LANGUAGE python AS
+$python$
+def main(state, value):
+	if state is None:
+		state = []
+	if value is not None:
+		state.append(float(value))
+	return state
+$python$;
+
+CREATE FUNCTION median_final(internal) RETURNS float8 LANGUAGE python AS
+$python$
+def main(state):
+	if not state:
+		return None
+	state.sort()
+	return state[len(state) // 2]
+$python$;
+
+CREATE AGGREGATE median(float8) (
+ SFUNC = median_step,
+ STYPE = internal,
+ FINALFUNC = median_final
+);
+
+SELECT median(i) FROM generate_series(1, 9) AS g(i);
+SELECT median(i) FROM generate_series(1, 9) AS g(i) GROUP BY i % 2 ORDER BY 1;
+
+CREATE FUNCTION running_sum(int) RETURNS bigint WINDOW LANGUAGE python AS
+$python$
+def main(window, i):
+	window.state = (window.state or 0) + int(i)
+	return window.state
+$python$;
+
+CREATE FUNCTION frame_values(int) RETURNS text WINDOW LANGUAGE python AS
+$python$
+def main(window, i):
+	return ','.join(map(str, window.frame()))
+$python$;
+
+SELECT i, running_sum(i) OVER (PARTITION BY i % 2 ORDER BY i) FROM generate_series(1, 6) AS g(i) ORDER BY i;
+SELECT i, frame_values(i) OVER (ORDER BY i) FROM generate_series(1, 4) AS g(i);
@@ -271,3 +271,166 @@ SELECT inhibited_pl_context_warning(true);
 SELECT inhibited_pl_context_warning(false);
 -- and what happens if it's None (default takes effect)
 SELECT inhibited_pl_context_warning(NULL);
+
+-- Postgres.reset drops the modules loaded since initialization
+CREATE OR REPLACE FUNCTION check_reset() RETURNS text LANGUAGE python AS
+$python$
+import sys
+import builtins
+import Postgres
+
+def main():
+	import colorsys
+	builtins.reset_marker = True
+	assert str(__func__.oid) in sys.modules
+	Postgres.reset()
+	assert 'colorsys' not in sys.modules
+	assert str(__func__.oid) not in sys.modules
+	assert not hasattr(builtins, 'reset_marker')
+	assert sys.modules['Postgres'] is Postgres
+	return 'success'
+$python$;
+
+SELECT check_reset();
+SELECT check_reset();
+
+-- names of the Postgres module are restored
+CREATE OR REPLACE FUNCTION check_reset_names() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+def main():
+	original = Postgres.eval
+	Postgres.eval = lambda *args: None
+	Postgres.reset_names_marker = True
+	Postgres.reset()
+	assert Postgres.eval is original
+	assert not hasattr(Postgres, 'reset_names_marker')
+	Postgres.reset()
+	assert Postgres.eval is original
+	return 'success'
+$python$;
+SELECT check_reset_names();
+
+-- python.isolation resets the environment when the role changes
+CREATE ROLE python_isolation_role;
+CREATE OR REPLACE FUNCTION isolation_marker() RETURNS text LANGUAGE python AS
+$python$
+import builtins
+
+def main():
+	r = str(getattr(builtins, 'isolation_marker', None))
+	builtins.isolation_marker = 'set'
+	return r
+$python$;
+SET python.isolation = 'role';
+SELECT isolation_marker();
+SELECT isolation_marker();
+SET ROLE python_isolation_role;
+SELECT isolation_marker();
+SELECT isolation_marker();
+RESET ROLE;
+SELECT isolation_marker();
+RESET python.isolation;
+DROP FUNCTION isolation_marker();
+DROP ROLE python_isolation_role;
+
+-- Postgres.queue_notify; nothing listens to the channels, as psql would
+-- print the notifications with the pid of the backend.
+CREATE OR REPLACE FUNCTION check_queue_notify() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+def main():
+	Postgres.flush_notify()
+	assert Postgres.queued_notifies() == []
+
+	Postgres.queue_notify('regress_queue_a')
+	Postgres.queue_notify('regress_queue_b')
+	Postgres.queue_notify('regress_queue_a')
+	assert Postgres.queued_notifies() == [
+		('regress_queue_a', None),
+		('regress_queue_b', None),
+	]
+
+	if Postgres.version_info[:2] >= (9, 0):
+		Postgres.queue_notify('regress_queue_a', 'payload')
+		Postgres.queue_notify('regress_queue_a', 'payload')
+		assert Postgres.queued_notifies()[-1] == ('regress_queue_a', 'payload')
+		assert len(Postgres.queued_notifies()) == 3
+
+	Postgres.flush_notify()
+	assert Postgres.queued_notifies() == []
+
+	# discarded with the subtransaction
+	try:
+		with xact():
+			Postgres.queue_notify('regress_queue_aborted')
+			raise ValueError('abort')
+	except ValueError:
+		pass
+	assert Postgres.queued_notifies() == []
+
+	# kept by the parent when the subtransaction commits
+	with xact():
+		Postgres.queue_notify('regress_queue_committed')
+		with xact():
+			Postgres.queue_notify('regress_queue_nested')
+	try:
+		with xact():
+			# already queued by the parent; not discarded
+			Postgres.queue_notify('regress_queue_committed')
+			raise ValueError('abort')
+	except ValueError:
+		pass
+	assert Postgres.queued_notifies() == [
+		('regress_queue_committed', None),
+		('regress_queue_nested', None),
+	]
+
+	try:
+		Postgres.queue_notify('')
+	except ValueError:
+		pass
+	else:
+		assert False, "ValueError not raised"
+	return 'success'
+$python$;
+SELECT check_queue_notify();
+
+-- Postgres.listen and Postgres.unlisten
+CREATE OR REPLACE FUNCTION py_listen(text[]) RETURNS VOID LANGUAGE python AS
+$python$
+import Postgres
+
+def main(channels):
+	Postgres.listen(*channels)
+$python$;
+CREATE OR REPLACE FUNCTION py_unlisten(text[]) RETURNS VOID LANGUAGE python AS
+$python$
+import Postgres
+
+def main(channels):
+	Postgres.unlisten(*channels)
+$python$;
+CREATE OR REPLACE FUNCTION listening_channels() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+if Postgres.version_info[:2] >= (9, 0):
+	channels = prepare("SELECT pg_catalog.pg_listening_channels()")
+else:
+	channels = prepare(
+		"SELECT relname::text FROM pg_catalog.pg_listener "
+		"WHERE listenerpid = pg_catalog.pg_backend_pid()"
+	)
+
+def main():
+	return ','.join(sorted(str(x[0]) for x in channels()))
+$python$;
+SELECT py_listen(ARRAY['regress_listen_a', 'regress_listen_b', 'regress_listen_c']);
+SELECT listening_channels();
+SELECT py_unlisten(ARRAY['regress_listen_b']);
+SELECT listening_channels();
+SELECT py_unlisten(ARRAY[]::text[]);
+SELECT listening_channels();
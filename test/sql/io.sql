@@ -131,3 +131,46 @@ def main():
 	return "bar"
 $python$;
 SELECT changing();
+
+-- str to text-like Datums and back
+CREATE OR REPLACE FUNCTION check_string_conversions() RETURNS text LANGUAGE python AS
+$python$
+import codecs
+import Postgres
+from Postgres.types import text, varchar, bpchar, name
+
+utf8 = codecs.lookup(Postgres.encoding).name == 'utf-8'
+
+def main():
+	# name is truncated like namein does
+	assert str(name('x' * 70)) == 'x' * 63
+	if utf8:
+		# without splitting a character
+		assert str(name('\u00e9' * 40)) == '\u00e9' * 31
+
+	# bpchar is only padded by typinput when a typmod is given
+	assert str(bpchar('ab')) == 'ab'
+	assert str(bpchar('ab  ')) == 'ab  '
+	assert str(bpchar('ab', mod = (4,))) == 'ab  '
+	assert str(varchar('abc')) == 'abc'
+
+	# strings with a NUL are given to typinput, which truncates them
+	assert str(text('a\x00b')) == 'a'
+	assert str(varchar('a\x00b')) == 'a'
+
+	# strings that cannot be encoded are not replaced
+	try:
+		with xact():
+			text('\udc80')
+	except Exception:
+		pass
+	else:
+		assert False, "unencodable str was accepted"
+
+	if utf8:
+		s = '\u00e9\u4e2d\U0001F600'
+		assert str(text(s)) == s
+		assert str(prepare("SELECT $1::text").first(s)) == s
+	return 'success'
+$python$;
+SELECT check_string_conversions();
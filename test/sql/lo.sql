@@ -63,3 +63,53 @@ DROP TABLE IF EXISTS dis_lo;
 CREATE TABLE dis_lo (o oid);
 INSERT INTO dis_lo VALUES (write_some_lo_data());
 SELECT read_some_lo_data(o) FROM dis_lo;
+
+CREATE OR REPLACE FUNCTION check_lo_buffers() RETURNS text LANGUAGE python AS
+$python$
+import io
+import Postgres
+
+def main():
+	with Postgres.LargeObject.tmp() as lo:
+		data = bytearray(b'0123456789' * 10)
+		assert lo.write(memoryview(data)[:50]) == 50
+		assert lo.write(data[50:]) == 50
+		lo.seek(0)
+		buf = bytearray(30)
+		assert lo.readinto(buf) == 30
+		assert buf == data[:30]
+		assert lo.readinto(memoryview(buf)[:10]) == 10
+		assert buf[:10] == data[30:40]
+		assert b''.join(lo.chunks(16)) == data[40:]
+		lo.seek(0)
+		lo.block_size = 7
+		assert list(lo.chunks()) == [bytes(data[x:x+7]) for x in range(0, 100, 7)]
+		lo.seek(0)
+		lo.write(b'line1\nline2\nline3')
+		lo.seek(0)
+		assert lo.readline() == b'line1\n'
+		assert lo.readline(3) == b'lin'
+		lo.seek(0)
+		r = io.BufferedReader(lo)
+		assert r.readline() == b'line1\n'
+		assert r.readline() == b'line2\n'
+		# reads larger than lo_read accepts are made in block_size chunks
+		lo._read_max = 10
+		contents = b'line1\nline2\nline3' + bytes(data[17:])
+		lo.seek(0)
+		assert lo.read() == contents
+		lo.seek(5)
+		assert lo.read(20) == contents[5:25]
+		assert lo.read(200) == contents[25:]
+		# long lines are read with growing reads, and the position is exact
+		lo.block_size = 1024
+		lo.seek(100)
+		lo.write(b'x' * 300 + b'\ny\n')
+		lo.seek(100)
+		assert lo.readline() == b'x' * 300 + b'\n'
+		assert lo.tell() == 401
+		assert list(lo) == [b'y\n']
+	return 'success'
+$python$;
+
+SELECT check_lo_buffers();
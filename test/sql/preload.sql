@@ -61,3 +61,20 @@ SELECT preload_schemas('{nsp_a}'::text[]);
 
 SELECT nsp_a.test_settings();
 SHOW standard_conforming_strings;
+
+-- python.preload entries that fail to load are reported as WARNINGs,
+-- and the call that triggered the preload proceeds.
+\c
+CREATE SCHEMA nsp_broken;
+CREATE FUNCTION nsp_broken.foo() RETURNS VOID LANGUAGE python AS
+$$
+undefined_name_in_module
+
+def main():
+	pass
+$$;
+SET python.preload = 'nsp_broken, nsp_a.missing()';
+SELECT nsp_b.foo();
+RESET python.preload;
+DROP FUNCTION nsp_broken.foo();
+DROP SCHEMA nsp_broken;
@@ -6,7 +6,7 @@ import Postgres
 @pytypes
 def main(B, Bs, i2, i4, i8, f4, f8, txt, vc):
 	assert type(B) is bool
-	assert type(Bs) is bytes
+	assert type(Bs) is memoryview
 	assert type(i2) is int
 	assert type(i4) is int
 	assert type(i8) is int
@@ -37,7 +37,7 @@ def main(*args):
 	args = list(iterpytypes([args]))[0]
 	B, Bs, i2, i4, i8, f4, f8, txt, vc = args
 	assert type(B) is bool
-	assert type(Bs) is bytes
+	assert type(Bs) is memoryview
 	assert type(i2) is int
 	assert type(i4) is int
 	assert type(i8) is int
@@ -243,6 +243,62 @@ RELEASE a;
 SELECT cached_cursor(false);
 ABORT;
 
+-- WITH HOLD cursors remain open after the transaction commits.
+CREATE OR REPLACE FUNCTION held_cursor() RETURNS int LANGUAGE python AS
+$python$
+cur = prepare("SELECT i FROM generate_series(1, 3) AS g(i)").declare_with_hold()
+
+def main():
+	return cur.read(1)[0][0]
+$python$;
+
+SELECT held_cursor();
+SELECT held_cursor();
+SELECT held_cursor();
+
+-- rows_with_hold() cursors remain open too, and close() releases the Portal.
+CREATE OR REPLACE FUNCTION held_rows() RETURNS int LANGUAGE python AS
+$python$
+cur = prepare("SELECT i FROM generate_series(1, 3) AS g(i)").rows_with_hold()
+is_open = prepare("SELECT count(*) FROM pg_catalog.pg_cursors WHERE name = $1")
+
+def main():
+	global cur
+	if cur is None:
+		return 0
+	i = next(cur)[0]
+	if i == 3:
+		assert is_open.first(cur.cursor_id) == 1
+		cur.close()
+		assert is_open.first(cur.cursor_id) == 0
+		cur = None
+	return i
+$python$;
+
+SELECT held_rows();
+SELECT held_rows();
+SELECT held_rows();
+SELECT held_rows();
+
+-- A held cursor is closed when the transaction that opened it aborts.
+CREATE OR REPLACE FUNCTION held_aborted(open bool) RETURNS int LANGUAGE python AS
+$python$
+ps = prepare("SELECT i FROM generate_series(1, 3) AS g(i)")
+cur = None
+
+def main(open):
+	global cur
+	if open:
+		cur = ps.declare_with_hold()
+	return cur.read(1)[0][0]
+$python$;
+
+BEGIN;
+SELECT held_aborted(true);
+ABORT;
+-- should fail with cursor is closed
+SELECT held_aborted(false);
+
 
 DROP SEQUENCE IF EXISTS kvpair_seq;
 CREATE SEQUENCE kvpair_seq;
@@ -848,3 +904,127 @@ ALTER TABLE it_gets_changed ADD COLUMN c3 text;
 ALTER TABLE it_gets_changed DROP COLUMN c3;
 -- expecting an invalidated WARNING here.
 SELECT invalidated_anonymous_composites();
+
+-- Postgres.eval and Postgres.execute cache their statements
+CREATE OR REPLACE FUNCTION check_plan_cache() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+pc = Postgres.plan_cache
+
+def main():
+	pc.clear()
+	for i in range(3):
+		assert Postgres.eval('$1::int + 1', i) == i + 1
+	assert (pc.hits, pc.misses) == (2, 1)
+
+	# utility statements are not cached
+	Postgres.execute("CREATE TEMP TABLE plan_cache_t (i int)")
+	assert len(pc) == 1
+	for i in range(3):
+		Postgres.execute("INSERT INTO plan_cache_t VALUES (1)")
+	assert len(pc) == 2
+	assert Postgres.eval('(SELECT count(*) FROM plan_cache_t)') == 3
+	Postgres.execute("DROP TABLE plan_cache_t")
+	assert (pc.hits, pc.misses) == (4, 5)
+
+	pc.size = 1
+	assert len(pc) == 1
+	pc.size = 64
+	Postgres.clearcache()
+	assert len(pc) == 0
+	return 'success'
+$python$;
+
+SELECT check_plan_cache();
+
+-- the arguments of Postgres.eval are the values of the parameters, and
+-- the rows of a cached query are read and discarded
+CREATE OR REPLACE FUNCTION check_plan_cache_execution() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+def main():
+	assert str(Postgres.eval("$1::text || 'x'", 'a')) == 'ax'
+	assert str(Postgres.eval("$1::text || 'x'", 'b')) == 'bx'
+	assert Postgres.eval("$1::int + $2::int", 1, 2) == 3
+
+	Postgres.execute("CREATE TEMP SEQUENCE plan_cache_s")
+	sql = "SELECT nextval('plan_cache_s') FROM generate_series(1, 250)"
+	Postgres.execute(sql)
+	Postgres.execute(sql)
+	assert Postgres.eval("currval('plan_cache_s')") == 500
+	Postgres.execute("DROP SEQUENCE plan_cache_s")
+	return 'success'
+$python$;
+
+SELECT check_plan_cache_execution();
+
+-- next() reads ahead; seek() and read() must see the cursor's position
+CREATE OR REPLACE FUNCTION scrollable_read_ahead() RETURNS text LANGUAGE python AS
+$python$
+ps = prepare("SELECT i FROM generate_series(1, 120) AS g(i)")
+
+def main():
+	c = ps.declare()
+	assert next(c)[0] == 1
+	assert next(c)[0] == 2
+	c.seek(3, 1)
+	assert next(c)[0] == 6
+	assert [x for x, in c.read(2)] == [7, 8]
+	assert next(c)[0] == 9
+	assert [x for x, in c.read(2, 'BACKWARD')] == [8, 7]
+	assert next(c)[0] == 8
+	assert [x for x, in c] == list(range(9, 121))
+	assert [x for x, in c.read(1, 'BACKWARD')] == [120]
+
+	# rows read ahead up to the end
+	c = ps.declare()
+	c.seek(100)
+	assert next(c)[0] == 101
+	assert [x for x, in c.read(1)] == [102]
+
+	c = ps.declare()
+	c.direction = False
+	c.seek(0)
+	assert next(c)[0] == 120
+	c.seek(2, 1)
+	assert next(c)[0] == 117
+	assert [x for x, in c.read(1)] == [116]
+	c.direction = True
+	assert next(c)[0] == 117
+	return 'success'
+$python$;
+
+SELECT scrollable_read_ahead();
+
+-- rows read ahead are not returned once the cursor is closed
+CREATE OR REPLACE FUNCTION closed_read_ahead() RETURNS int LANGUAGE python AS
+$python$
+ps = prepare("SELECT i FROM generate_series(1, 120) AS g(i)")
+
+def main():
+	c = ps.declare()
+	assert next(c)[0] == 1
+	c.close()
+	return next(c)[0]
+$python$;
+
+-- should fail with cursor is closed
+SELECT closed_read_ahead();
+
+-- or once the transaction that declared it has ended
+CREATE OR REPLACE FUNCTION ended_read_ahead(start bool) RETURNS int LANGUAGE python AS
+$python$
+ps = prepare("SELECT i FROM generate_series(1, 120) AS g(i)")
+c = None
+
+def main(start):
+	global c
+	if start:
+		c = ps.declare()
+	return next(c)[0]
+$python$;
+
+SELECT ended_read_ahead(true);
+-- should fail with cursor is closed
+SELECT ended_read_ahead(false);
@@ -53,3 +53,50 @@ SELECT one_two_three_records_d();
 SELECT one_two_three_records_d() LIMIT 2;
 SELECT * FROM one_two_three_records_d();
 SELECT * FROM one_two_three_records_d() LIMIT 2;
+
+CREATE OR REPLACE FUNCTION batch_product(int[], int[]) RETURNS SETOF int
+LANGUAGE python AS
+$python$
+from Postgres import Batch
+
+@Batch
+def main(a, b):
+	return [x * y for x, y in zip(a, b)]
+$python$;
+
+CREATE OR REPLACE FUNCTION batch_product(int, int) RETURNS int
+LANGUAGE python AS
+$python$
+from Postgres import Batch
+
+@Batch
+def main(a, b):
+	return [x * y for x, y in zip(a, b)]
+$python$;
+
+SELECT unnest(a) AS a, batch_product(a, b) FROM (SELECT ARRAY[1,2,3] AS a, ARRAY[4,5,6] AS b) AS batch;
+SELECT batch_product(6, 7);
+
+-- the kernel is given builtin objects
+CREATE OR REPLACE FUNCTION batch_types(int[], float8[]) RETURNS SETOF text
+LANGUAGE python AS
+$python$
+from Postgres import Batch
+
+@Batch
+def main(a, b):
+	return [type(x).__name__ + ' ' + type(y).__name__ for x, y in zip(a, b)]
+$python$;
+
+CREATE OR REPLACE FUNCTION batch_types(int, float8) RETURNS text
+LANGUAGE python AS
+$python$
+from Postgres import Batch
+
+@Batch
+def main(a, b):
+	return [type(x).__name__ + ' ' + type(y).__name__ for x, y in zip(a, b)]
+$python$;
+
+SELECT batch_types(ARRAY[1,2], ARRAY[1.5,2.5]::float8[]);
+SELECT batch_types(1, 1.5);
@@ -132,3 +132,60 @@ def main(oid):
 $$;
 
 SELECT lookup_tables_type('explicit_lookup'::regclass);
+
+-- Casts in pg_cast. The function cast clears the caches and casts another
+-- value while it is running.
+CREATE TYPE cast_source AS (i int4);
+CREATE FUNCTION cast_source_text(cast_source) RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+def main(src):
+	i = src["i"]
+	if i > 0:
+		Postgres.clearcache()
+		return str(i) + ' ' + str(Postgres.types.text(type(src)((i - 1,))))
+	return str(i)
+$python$;
+CREATE CAST (cast_source AS text) WITH FUNCTION cast_source_text(cast_source);
+
+CREATE FUNCTION cast_source_as_text(int4) RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+
+rt = Postgres.Type(Postgres.CONST['REGTYPEOID'])
+cast_source = Postgres.Type(rt('cast_source'))
+
+def main(i):
+	return str(Postgres.types.text(cast_source((i,))))
+$python$;
+SELECT cast_source_as_text(2);
+SELECT cast_source_as_text(1);
+-- Without the cast, typinput is given the composite's string.
+DROP CAST (cast_source AS text);
+SELECT cast_source_as_text(2);
+DROP FUNCTION cast_source_as_text(int4);
+DROP FUNCTION cast_source_text(cast_source);
+DROP TYPE cast_source;
+
+-- Binary coercible casts reuse the value unless a typmod is given.
+CREATE FUNCTION check_binary_casts() RETURNS text LANGUAGE python AS
+$python$
+from Postgres.types import text, varchar
+
+def main():
+	t = text(varchar('binary'))
+	assert type(t) is text
+	assert str(t) == 'binary'
+
+	v = varchar(text('binary'))
+	assert type(v) is varchar
+	assert str(v) == 'binary'
+
+	# typinput applies the typmod
+	v = varchar(text('binary'), mod = (10,))
+	assert type(v) is varchar
+	assert str(v) == 'binary'
+	return 'success'
+$python$;
+SELECT check_binary_casts();
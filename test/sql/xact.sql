@@ -203,3 +203,49 @@ SELECT call_broken_but_recover_noxact();
 INSERT INTO pyxact_test VALUES (2020);
 COMMIT;
 SELECT i FROM pyxact_test WHERE i = 2020;
+
+-- deferred subtransactions only start on database access
+CREATE OR REPLACE FUNCTION deferred_xact() RETURNS text LANGUAGE python AS
+$python$
+import Postgres
+ins = prepare('INSERT INTO pyxact_test VALUES ($1)')
+
+def main():
+	st = Postgres.stats()
+	started, avoided = st['subxacts'], st['subxacts_avoided']
+	with xact(deferred = True):
+		with xact(deferred = True):
+			pass
+	st = Postgres.stats()
+	assert st['subxacts'] == started
+	assert st['subxacts_avoided'] == avoided + 2
+
+	try:
+		with xact(deferred = True):
+			with xact(deferred = True):
+				ins(7070)
+			raise ValueError("rollback")
+	except ValueError:
+		pass
+	assert Postgres.stats()['subxacts'] == started + 2
+	return str(prepare('SELECT count(*) FROM pyxact_test WHERE i = 7070').first())
+$python$;
+
+SELECT deferred_xact();
+
+-- deferred subtransactions that are entered and not exited are discarded
+CREATE OR REPLACE FUNCTION entered_deferred_xact() RETURNS VOID LANGUAGE python AS
+$python$
+def main():
+	x = xact(deferred = True)
+	x.__enter__()
+$python$;
+SELECT entered_deferred_xact();
+CREATE OR REPLACE FUNCTION entered_exc_deferred_xact() RETURNS VOID LANGUAGE python AS
+$python$
+def main():
+	x = xact(deferred = True)
+	x.__enter__()
+	raise ValueError("deferred xact WARNING should get thrown")
+$python$;
+SELECT entered_exc_deferred_xact();
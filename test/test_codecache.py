@@ -0,0 +1,127 @@
+##
+# python.code_cache_directory; the compiled code cache.
+#
+# Like test_shared.py, this runs against a temporary cluster created by
+# postgresql.temporal.pg_tmp. The cluster is restarted with the cache
+# directory set to a new temporary directory.
+##
+import os
+import shutil
+import tempfile
+import unittest
+from postgresql.temporal import pg_tmp
+
+mklang_90 = """
+CREATE SCHEMA __python__;
+SET search_path = __python__;
+
+CREATE FUNCTION
+ "handler"()
+RETURNS LANGUAGE_HANDLER LANGUAGE C AS 'python', 'pl_handler';
+
+CREATE FUNCTION
+ "validator"(oid)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_validator';
+
+CREATE FUNCTION
+ "inline"(INTERNAL)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_inline';
+
+CREATE LANGUAGE python HANDLER "handler" INLINE "inline" VALIDATOR "validator";
+"""
+
+cache_stats = """
+CREATE OR REPLACE FUNCTION
+public.cache_stats() RETURNS int8[] LANGUAGE python AS
+$$
+import Postgres
+
+def main():
+	st = Postgres.stats()
+	return [st['code_cache_hits'], st['code_cache_misses']]
+$$;
+"""
+
+cached = """
+CREATE OR REPLACE FUNCTION
+public.%(name)s() RETURNS text LANGUAGE python AS
+$$
+def main():
+	return %(result)r
+$$;
+"""
+
+funcs = [
+	cache_stats,
+]
+
+directory = None
+
+def load(name):
+	"""
+	Call the function in a new backend, and get the number of cache hits and
+	misses caused by loading it.
+	"""
+	con = db.clone()
+	try:
+		stats = con.proc('cache_stats()')
+		before = stats()
+		result = con.proc(name + '()')()
+		after = stats()
+	finally:
+		con.close()
+	return result, (after[0] - before[0], after[1] - before[1])
+
+class test_codecache(unittest.TestCase):
+	@pg_tmp
+	def testHit(self):
+		sqlexec(cached % {'name': 'cached_hit', 'result': 'first'})
+		self.failUnlessEqual(load('cached_hit'), ('first', (0, 1)))
+		self.failUnlessEqual(load('cached_hit'), ('first', (1, 0)))
+		self.failUnlessEqual(load('cached_hit'), ('first', (1, 0)))
+
+	@pg_tmp
+	def testInvalidation(self):
+		sqlexec(cached % {'name': 'cached_replaced', 'result': 'first'})
+		self.failUnlessEqual(load('cached_replaced'), ('first', (0, 1)))
+		self.failUnlessEqual(load('cached_replaced'), ('first', (1, 0)))
+
+		# The new xmin and source are a new entry.
+		sqlexec(cached % {'name': 'cached_replaced', 'result': 'second'})
+		self.failUnlessEqual(load('cached_replaced'), ('second', (0, 1)))
+		self.failUnlessEqual(load('cached_replaced'), ('second', (1, 0)))
+
+	@pg_tmp
+	def testUnsafeDirectory(self):
+		sqlexec(cached % {'name': 'cached_unsafe', 'result': 'first'})
+		os.chmod(directory, 0o777)
+		try:
+			# Neither read nor written.
+			entries = os.listdir(directory)
+			self.failUnlessEqual(load('cached_unsafe'), ('first', (0, 0)))
+			self.failUnlessEqual(load('cached_unsafe'), ('first', (0, 0)))
+			self.failUnlessEqual(os.listdir(directory), entries)
+		finally:
+			os.chmod(directory, 0o700)
+		self.failUnlessEqual(load('cached_unsafe'), ('first', (0, 1)))
+		self.failUnlessEqual(load('cached_unsafe'), ('first', (1, 0)))
+
+if __name__ == '__main__':
+	from types import ModuleType
+	this = ModuleType("this")
+	this.__dict__.update(globals())
+	directory = tempfile.mkdtemp(prefix = 'pg_python_code_cache')
+	this.directory = directory
+	try:
+		pg_tmp.init()
+		pg_tmp.cluster.settings.update({
+			'python.code_cache_directory': directory,
+		})
+		pg_tmp.cluster.restart()
+		with pg_tmp:
+			sqlexec(mklang_90)
+			for x in funcs:
+				sqlexec(x)
+		unittest.main(this)
+	finally:
+		shutil.rmtree(directory)
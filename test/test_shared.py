@@ -0,0 +1,186 @@
+##
+# Postgres.shared in a cluster that preloads the extension.
+#
+# Like test_interrupt.py, this runs against a temporary cluster created by
+# postgresql.temporal.pg_tmp. The cluster is restarted with
+# shared_preload_libraries and python.shared_memory before the tests run.
+##
+import unittest
+from postgresql.exceptions import Error, InsufficientPrivilegeError
+from postgresql.temporal import pg_tmp
+
+mklang_90 = """
+CREATE SCHEMA __python__;
+SET search_path = __python__;
+
+CREATE FUNCTION
+ "handler"()
+RETURNS LANGUAGE_HANDLER LANGUAGE C AS 'python', 'pl_handler';
+
+CREATE FUNCTION
+ "validator"(oid)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_validator';
+
+CREATE FUNCTION
+ "inline"(INTERNAL)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_inline';
+
+CREATE LANGUAGE python HANDLER "handler" INLINE "inline" VALIDATOR "validator";
+"""
+
+settings = {
+	'shared_preload_libraries': 'python',
+	'python.shared_memory': '64',
+}
+
+publish = """
+CREATE OR REPLACE FUNCTION
+public.publish(text, text) RETURNS bigint LANGUAGE python AS
+$$
+import Postgres
+
+def main(name, data):
+	return Postgres.shared.publish(name, str(data).encode('utf-8'))
+$$;
+"""
+
+read = """
+CREATE OR REPLACE FUNCTION
+public.read(text) RETURNS text LANGUAGE python AS
+$$
+import Postgres
+
+def main(name):
+	view = Postgres.shared.get(name)
+	if view is None:
+		return None
+	assert view.readonly
+	return bytes(view).decode('utf-8')
+$$;
+"""
+
+version = """
+CREATE OR REPLACE FUNCTION
+public.version(text) RETURNS bigint LANGUAGE python AS
+$$
+import Postgres
+
+def main(name):
+	return Postgres.shared.version(name)
+$$;
+"""
+
+keys = """
+CREATE OR REPLACE FUNCTION
+public.keys() RETURNS text LANGUAGE python AS
+$$
+import Postgres
+
+def main():
+	return ','.join(sorted(Postgres.shared.keys()))
+$$;
+"""
+
+# Keep views of a buffer in the backend's globals; None releases them.
+hold = """
+CREATE OR REPLACE FUNCTION
+public.hold(text) RETURNS int LANGUAGE python AS
+$$
+import Postgres
+
+held = []
+
+def main(name):
+	if name is None:
+		del held[:]
+	else:
+		held.append(Postgres.shared[name])
+	return len(held)
+$$;
+"""
+
+funcs = [
+	publish,
+	read,
+	version,
+	keys,
+	hold,
+]
+
+class test_shared(unittest.TestCase):
+	@pg_tmp
+	def testPublish(self):
+		v1 = proc('publish(text,text)')('test_publish', 'first')
+		self.failUnlessEqual(proc('read(text)')('test_publish'), 'first')
+		self.failUnlessEqual(proc('version(text)')('test_publish'), v1)
+
+		v2 = proc('publish(text,text)')('test_publish', 'second')
+		self.failUnless(v2 > v1)
+		self.failUnlessEqual(proc('read(text)')('test_publish'), 'second')
+		self.failUnlessEqual(proc('version(text)')('test_publish'), v2)
+		self.failUnless('test_publish' in proc('keys()')().split(','))
+
+	@pg_tmp
+	def testOtherBackend(self):
+		proc('publish(text,text)')('test_other', 'data')
+		other = db.clone()
+		try:
+			read = other.proc('read(text)')
+			self.failUnlessEqual(read('test_other'), 'data')
+			self.failUnlessEqual(read('test_absent'), None)
+		finally:
+			other.close()
+
+	@pg_tmp
+	def testReclaim(self):
+		# Two versions fit in the 64kB region, three do not.
+		data = 'x' * (24 * 1024)
+		publish = proc('publish(text,text)')
+		publish('test_reclaim', data)
+		publish('test_reclaim', data)
+		publish('test_reclaim', data)
+		self.failUnlessEqual(proc('read(text)')('test_reclaim'), data)
+
+		other = db.clone()
+		try:
+			hold = other.proc('hold(text)')
+			self.failUnlessEqual(hold('test_reclaim'), 1)
+			# The viewed version is kept after it is replaced.
+			publish('test_reclaim', data)
+			try:
+				publish('test_reclaim', data)
+			except Error as err:
+				self.failUnlessEqual(err.code, '53200')
+			else:
+				self.fail("the space of a viewed version was reused")
+			self.failUnlessEqual(hold(None), 0)
+			publish('test_reclaim', data)
+		finally:
+			other.close()
+
+	@pg_tmp
+	def testSuperuser(self):
+		sqlexec("CREATE ROLE test_shared_reader")
+		try:
+			sqlexec("SET ROLE test_shared_reader")
+			try:
+				self.failUnlessRaises(InsufficientPrivilegeError,
+					proc('publish(text,text)'), 'test_superuser', 'data')
+			finally:
+				sqlexec("RESET ROLE")
+			self.failUnlessEqual(proc('read(text)')('test_superuser'), None)
+		finally:
+			sqlexec("DROP ROLE test_shared_reader")
+
+if __name__ == '__main__':
+	from types import ModuleType
+	this = ModuleType("this")
+	this.__dict__.update(globals())
+	pg_tmp.init()
+	pg_tmp.cluster.settings.update(settings)
+	pg_tmp.cluster.restart()
+	with pg_tmp:
+		sqlexec(mklang_90)
+		for x in funcs:
+			sqlexec(x)
+	unittest.main(this)
@@ -0,0 +1,96 @@
+##
+# The python_stats() and python_reset_stats() functions installed by
+# CREATE EXTENSION.
+#
+# Like test_interrupt.py, this runs against a temporary cluster created by
+# postgresql.temporal.pg_tmp, and requires the extension to be installed.
+##
+import unittest
+from postgresql.temporal import pg_tmp
+
+counted = """
+CREATE OR REPLACE FUNCTION
+public.counted() RETURNS int LANGUAGE python AS
+$$
+import Postgres
+
+ps = prepare("SELECT 1")
+
+def main():
+	return ps.first()
+$$;
+"""
+
+failing = """
+CREATE OR REPLACE FUNCTION
+public.failing() RETURNS int LANGUAGE python AS
+$$
+def main():
+	raise ValueError("failing")
+$$;
+"""
+
+funcs = [
+	counted,
+	failing,
+]
+
+stats = """
+SELECT calls, errors, loads, spi_calls, total, initialize, main, spi
+FROM python_stats() WHERE function = $1::regprocedure
+"""
+
+class test_stats(unittest.TestCase):
+	@pg_tmp
+	def testStats(self):
+		sqlexec("SELECT python_reset_stats()")
+		proc('counted()')()
+		proc('counted()')()
+		self.failUnlessRaises(Exception, proc('failing()'))
+
+		calls, errors, loads, spi_calls, total, initialize, main, spi = \
+			prepare(stats).first('counted()')
+		self.failUnlessEqual(calls, 2)
+		self.failUnlessEqual(errors, 0)
+		self.failUnlessEqual(spi_calls, 2)
+		# python.track_functions is off
+		self.failUnlessEqual((total, initialize, main, spi), (0.0, 0.0, 0.0, 0.0))
+
+		calls, errors = prepare(stats).first('failing()')[:2]
+		self.failUnlessEqual(errors, 1)
+
+	@pg_tmp
+	def testTiming(self):
+		sqlexec("SELECT python_reset_stats()")
+		sqlexec("SET python.track_functions = on")
+		try:
+			proc('counted()')()
+		finally:
+			sqlexec("RESET python.track_functions")
+
+		calls, errors, loads, spi_calls, total, initialize, main, spi = \
+			prepare(stats).first('counted()')
+		self.failUnlessEqual(calls, 1)
+		self.failUnless(total > 0)
+		self.failUnless(main > 0)
+		self.failUnless(total >= initialize + main)
+		# the query is executed by main
+		self.failUnless(0 < spi <= main)
+
+	@pg_tmp
+	def testReset(self):
+		proc('counted()')()
+		sqlexec("SELECT python_reset_stats()")
+		# Entries that were not used since the reset are not returned.
+		self.failUnlessEqual(prepare(stats).first('counted()'), None)
+
+if __name__ == '__main__':
+	from types import ModuleType
+	this = ModuleType("this")
+	this.__dict__.update(globals())
+	pg_tmp.init()
+	with pg_tmp:
+		sqlexec("CREATE EXTENSION python")
+		for x in funcs:
+			sqlexec(x)
+	unittest.main(this)
@@ -0,0 +1,202 @@
+##
+# Background workers; python.workers, Postgres.bgworker, and the queues
+# between a dynamic worker and the backend that started it.
+#
+# Like test_shared.py, this runs against a temporary cluster created by
+# postgresql.temporal.pg_tmp. The functions are created first, and the cluster
+# is then restarted with a python.workers entry that names one of them.
+##
+import unittest
+import time
+from postgresql.exceptions import Error, InsufficientPrivilegeError
+from postgresql.temporal import pg_tmp
+
+mklang_90 = """
+CREATE SCHEMA __python__;
+SET search_path = __python__;
+
+CREATE FUNCTION
+ "handler"()
+RETURNS LANGUAGE_HANDLER LANGUAGE C AS 'python', 'pl_handler';
+
+CREATE FUNCTION
+ "validator"(oid)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_validator';
+
+CREATE FUNCTION
+ "inline"(INTERNAL)
+RETURNS VOID LANGUAGE C AS 'python', 'pl_inline';
+
+CREATE LANGUAGE python HANDLER "handler" INLINE "inline" VALIDATOR "validator";
+"""
+
+ticks = """
+CREATE TABLE public.ticks (source text, pid int);
+"""
+
+# Record a call, and end the worker after three of them.
+tick = """
+CREATE OR REPLACE FUNCTION
+public.tick_%(source)s() RETURNS float8 LANGUAGE python AS
+$$
+import Postgres
+
+record = prepare(
+	"INSERT INTO public.ticks VALUES ('%(source)s', pg_catalog.pg_backend_pid())"
+)
+count = prepare("SELECT count(*) FROM public.ticks WHERE source = '%(source)s'")
+
+def main():
+	record()
+	if count.first() >= 3:
+		return None
+	return 0.05
+$$;
+"""
+
+start = """
+CREATE OR REPLACE FUNCTION
+public.start(text) RETURNS int LANGUAGE python AS
+$$
+import Postgres
+
+def main(function):
+	return Postgres.bgworker(function).pid
+$$;
+"""
+
+# Answer a single message, and end.
+echo_worker = """
+CREATE OR REPLACE FUNCTION
+public.echo_worker() RETURNS float8 LANGUAGE python AS
+$$
+import Postgres
+
+def main():
+	queue = Postgres.bgworker_queue()
+	message = queue.receive()
+	queue.send(message.upper() + b' ' + str(queue.pid).encode('ascii'))
+	return None
+$$;
+"""
+
+echo = """
+CREATE OR REPLACE FUNCTION
+public.echo(text) RETURNS text LANGUAGE python AS
+$$
+import Postgres
+
+def main(message):
+	worker = Postgres.bgworker('public.echo_worker')
+	worker.send(str(message).encode('ascii'))
+	return worker.receive().decode('ascii')
+$$;
+"""
+
+no_queue = """
+CREATE OR REPLACE FUNCTION
+public.no_queue() RETURNS bool LANGUAGE python AS
+$$
+import Postgres
+
+def main():
+	return Postgres.bgworker_queue() is None
+$$;
+"""
+
+not_a_worker = """
+CREATE OR REPLACE FUNCTION
+public.not_a_worker(int) RETURNS float8 LANGUAGE SQL AS 'SELECT NULL::float8';
+"""
+
+funcs = [
+	ticks,
+	tick % {'source': 'configured'},
+	tick % {'source': 'dynamic'},
+	start,
+	echo_worker,
+	echo,
+	no_queue,
+	not_a_worker,
+]
+
+def wait_for_ticks(source, count, timeout = 30):
+	ps = prepare("SELECT count(*) FROM public.ticks WHERE source = $1")
+	deadline = time.time() + timeout
+	while time.time() < deadline:
+		n = ps.first(source)
+		if n >= count:
+			return n
+		time.sleep(0.1)
+	return ps.first(source)
+
+class test_worker(unittest.TestCase):
+	@pg_tmp
+	def testConfigured(self):
+		if db.version_info[:2] < (9, 3):
+			return
+		# The worker may be restarted after it ends, so there can be more.
+		self.failUnless(wait_for_ticks('configured', 3) >= 3)
+
+	@pg_tmp
+	def testDynamic(self):
+		if db.version_info[:2] < (9, 5):
+			return
+		pid = proc('start(text)')('public.tick_dynamic')
+		self.failUnless(pid > 0)
+		self.failUnlessEqual(wait_for_ticks('dynamic', 3), 3)
+		pids = prepare(
+			"SELECT DISTINCT pid FROM public.ticks WHERE source = 'dynamic'"
+		)
+		self.failUnlessEqual(pids(), [(pid,)])
+
+	@pg_tmp
+	def testQueue(self):
+		if db.version_info[:2] < (9, 5):
+			return
+		backend = prepare("SELECT pg_catalog.pg_backend_pid()").first()
+		self.failUnlessEqual(proc('echo(text)')('ping'), 'PING %d' %(backend,))
+		self.failUnlessEqual(proc('no_queue()')(), True)
+
+	@pg_tmp
+	def testDynamicFunction(self):
+		if db.version_info[:2] < (9, 5):
+			return
+		try:
+			proc('start(text)')('public.not_a_worker(int)')
+		except Error as err:
+			self.failUnlessEqual(err.code, '42P13')
+		else:
+			self.fail("function with arguments was accepted")
+
+	@pg_tmp
+	def testDynamicSuperuser(self):
+		if db.version_info[:2] < (9, 5):
+			return
+		sqlexec("CREATE ROLE test_worker_starter")
+		try:
+			sqlexec("SET ROLE test_worker_starter")
+			try:
+				self.failUnlessRaises(InsufficientPrivilegeError,
+					proc('start(text)'), 'public.tick_dynamic')
+			finally:
+				sqlexec("RESET ROLE")
+		finally:
+			sqlexec("DROP ROLE test_worker_starter")
+
+if __name__ == '__main__':
+	from types import ModuleType
+	this = ModuleType("this")
+	this.__dict__.update(globals())
+	pg_tmp.init()
+	with pg_tmp:
+		sqlexec(mklang_90)
+		for x in funcs:
+			sqlexec(x)
+		database = prepare("SELECT pg_catalog.current_database()").first()
+	pg_tmp.cluster.settings.update({
+		'shared_preload_libraries': 'python',
+		'python.workers': database + ':public.tick_configured',
+	})
+	pg_tmp.cluster.restart()
+	unittest.main(this)